@@ -0,0 +1,89 @@
+﻿#include "JsonWriter.h"
+
+#include <cmath>
+#include <format>
+
+
+JsonWriter& JsonWriter::beginObject() {
+	beginValue();
+	out << '{';
+	hasElements.push_back(false);
+	return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+	hasElements.pop_back();
+	out << '}';
+	return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+	beginValue();
+	out << '[';
+	hasElements.push_back(false);
+	return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+	hasElements.pop_back();
+	out << ']';
+	return *this;
+}
+
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+	beginValue();
+	writeString(name);
+	out << ':';
+	afterKey = true;
+	return *this;
+}
+
+
+JsonWriter& JsonWriter::value(double number) {
+	beginValue();
+	if (std::isfinite(number)) out << std::format("{}", number);
+	else out << "null";
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+	beginValue();
+	out << (flag ? "true" : "false");
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+	beginValue();
+	writeString(text);
+	return *this;
+}
+
+
+void JsonWriter::beginValue() {
+	if (afterKey) {
+		afterKey = false;
+		return;
+	}
+	if (!hasElements.empty()) {
+		if (hasElements.back()) out << ',';
+		hasElements.back() = true;
+	}
+}
+
+void JsonWriter::writeString(std::string_view text) {
+	out << '"';
+	for (char c : text) {
+		switch (c) {
+		case '"': out << "\\\""; break;
+		case '\\': out << "\\\\"; break;
+		case '\n': out << "\\n"; break;
+		case '\r': out << "\\r"; break;
+		case '\t': out << "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) out << std::format("\\u{:04x}", static_cast<unsigned char>(c));
+			else out << c;
+		}
+	}
+	out << '"';
+}
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+
+// Writes compact JSON straight to a stream, without building a document in memory.
+class JsonWriter {
+public:
+	explicit JsonWriter(std::ostream& out) : out(out) {}
+
+	JsonWriter& beginObject();
+	JsonWriter& endObject();
+	JsonWriter& beginArray();
+	JsonWriter& endArray();
+
+	JsonWriter& key(std::string_view name);
+
+	// Non-finite numbers are written as null.
+	JsonWriter& value(double number);
+	JsonWriter& value(bool flag);
+	JsonWriter& value(std::string_view text);
+	JsonWriter& value(const char* text) {
+		return value(std::string_view(text));
+	}
+
+private:
+	void beginValue();
+	void writeString(std::string_view text);
+
+	std::ostream& out;
+	// Whether the object or array at each nesting level already has an element.
+	std::vector<bool> hasElements;
+	bool afterKey = false;
+};
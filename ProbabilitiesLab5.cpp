@@ -1,107 +1,43 @@
 ﻿#include <iostream>
-#include <ranges>
+#include <sstream>
 #include <filesystem>
-#include <fstream>
+#include <format>
+#include <algorithm>
+#include <numeric>
+#include <map>
+#include <optional>
+#include <limits>
+#include <cmath>
 
-#include <boost/math/distributions/normal.hpp>
-#include <boost/math/distributions/students_t.hpp>
-#include <boost/math/distributions/chi_squared.hpp>
+#include "Sample.h"
+#include "JsonWriter.h"
 
-#include <nlohmann/json.hpp>
 
-
-template<std::floating_point T, std::ranges::sized_range Range>
-	requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::pair<T, T>>
-T sampleSize(Range values) {
-	T count = 0;
-	for (const auto& [value, amount] : values) count += amount;
-	return count;
-}
-
-
-template<std::floating_point T, std::ranges::sized_range Range>
-	requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::pair<T, T>>
-T sampleMean(Range values) {
-	T mean = 0, count = 0;
-	for (const auto& [value, amount] : values) {
-		count += amount;
-		mean += amount * (value - mean) / count;
-	}
-	return mean;
-}
-
-
-template<std::floating_point T, std::ranges::sized_range Range>
-	requires std::is_convertible_v<std::ranges::range_value_t<Range>, std::pair<T, T>>
-T biasedSampleVariance(Range values) {
-	T mean = sampleMean<T>(values);
-	return sampleMean<T>(values |
-		std::views::transform([mean](std::pair<T, T> value) {
-			return std::pair<T, T>(std::pow(value.first - mean, 2), value.second); 
-		})
-	);
-}
+using namespace probstats;
 
 
-using nlohmann::json;
-
-json loadSample() {
+std::filesystem::path chooseSampleFile(std::ostream& prompt) {
 	auto samplesPath = std::filesystem::path("samples");
 
 	std::vector<std::filesystem::path> sampleFiles;
 	std::ranges::copy(std::filesystem::directory_iterator(samplesPath) |
 		std::views::transform([](auto directoryEntry) { return directoryEntry.path(); }), std::back_inserter(sampleFiles));
 
-	std::cout << "Available samples:\n";
+	prompt << "Available samples:\n";
 	for (int sampleIndex = 0; sampleIndex < sampleFiles.size(); sampleIndex++) {
-		std::cout << std::format("[{}] {}\n", sampleIndex + 1, sampleFiles[sampleIndex].stem().string());
+		const auto& sampleFile = sampleFiles[sampleIndex];
+		auto name = sampleFile.extension() == ".json" ? sampleFile.stem() : sampleFile.filename();
+		prompt << std::format("[{}] {}\n", sampleIndex + 1, name.string());
 	}
 
 	int sampleIndex = -1;
 	while (!(0 <= sampleIndex && sampleIndex < sampleFiles.size())) {
-		std::cout << "Choose sample: ";
+		prompt << "Choose sample: ";
 		std::cin >> sampleIndex;
 		sampleIndex--;
 	}
 
-	return json::parse(std::ifstream(sampleFiles[sampleIndex]));
-}
-
-
-using FloatType = double;
-
-
-
-std::pair<FloatType, FloatType> meanConfidenceIntervalWithKnownVariance(
-	FloatType sampleSize, FloatType statMean, FloatType variance, FloatType confidence
-) {
-	auto quantile = boost::math::quantile(boost::math::normal(), (confidence + 1) / 2);
-	auto epsilon = std::sqrt(variance / sampleSize) * quantile;
-	return { statMean - epsilon, statMean + epsilon };
-}
-
-std::pair<FloatType, FloatType> meanConfidenceIntervalWithUnknownVariance(
-	FloatType sampleSize, FloatType statMean, FloatType statUnbiasedVariance, FloatType confidence
-) {
-	auto quantile = boost::math::quantile(boost::math::students_t(sampleSize - 1), (confidence + 1) / 2);
-	auto epsilon = std::sqrt(statUnbiasedVariance / sampleSize) * quantile;
-	return { statMean - epsilon, statMean + epsilon };
-}
-
-
-std::pair<FloatType, FloatType> varianceConfidenceInterval(
-	FloatType sampleSize, FloatType statUnbiasedVariance, FloatType confidence
-) {
-	auto chi1 = boost::math::quantile(boost::math::chi_squared(sampleSize - 1), (1 + confidence) / 2);
-	auto chi2 = boost::math::quantile(boost::math::chi_squared(sampleSize - 1), (1 - confidence) / 2);
-	return { statUnbiasedVariance * (sampleSize - 1) / chi1, statUnbiasedVariance * (sampleSize - 1) / chi2 };
-}
-
-
-template<std::floating_point T, std::ranges::sized_range Range>
-	requires std::is_convertible_v<std::ranges::range_value_t<Range>, T>
-inline auto makeVarSeries(Range&& values) {
-	return values | std::views::transform([](T value) -> std::pair<T, T> { return { value, 1 }; });
+	return sampleFiles[sampleIndex];
 }
 
 
@@ -120,100 +56,553 @@ const std::vector<std::pair<std::string, std::string>> statisticsNames{
 	{ "unbiasedStandardDeviation", "Unbiased standard deviation" },
 };
 
+// Statistics that are only reported when requested with --statistics.
+const std::vector<std::pair<std::string, std::string>> extraStatisticsNames{
+	{ "minimum", "Minimum" },
+	{ "maximum", "Maximum" },
+	{ "skewness", "Skewness" },
+	{ "excessKurtosis", "Excess kurtosis" },
+	{ "percentile1", "1st percentile" },
+	{ "percentile5", "5th percentile" },
+	{ "lowerQuartile", "Lower quartile" },
+	{ "median", "Median" },
+	{ "upperQuartile", "Upper quartile" },
+	{ "percentile95", "95th percentile" },
+	{ "percentile99", "99th percentile" },
+	{ "interquartileRange", "Interquartile range" },
+};
 
-void calculateStatistics(json& sample, const auto& varSeries) {
-	auto size = sample["params"]["sampleSize"];
 
-	sample["statistics"]["mean"] = sampleMean<FloatType>(varSeries);
-	sample["statistics"]["biasedVariance"] = biasedSampleVariance<FloatType>(varSeries);
+const std::vector<std::pair<std::string, std::string>> intervalsNames{
+	{ "meanConfidenceIntervalWithKnownVariance", "Mean confidence interval (with known variance)" },
+	{ "meanConfidenceIntervalWithUnknownVariance", "Mean confidence interval (with unknown variance)" },
+	{ "varianceConfidenceInterval", "Variance condifence interval" },
+	{ "medianConfidenceInterval", "Median confidence interval (distribution-free)" },
+	{ "meanPercentileBootstrapInterval", "Mean bootstrap confidence interval (percentile)" },
+	{ "meanBasicBootstrapInterval", "Mean bootstrap confidence interval (basic)" },
+	{ "meanBcaBootstrapInterval", "Mean bootstrap confidence interval (BCa)" },
+	{ "variancePercentileBootstrapInterval", "Variance bootstrap confidence interval (percentile)" },
+	{ "varianceBasicBootstrapInterval", "Variance bootstrap confidence interval (basic)" },
+	{ "varianceBcaBootstrapInterval", "Variance bootstrap confidence interval (BCa)" },
+	{ "standardDeviationPercentileBootstrapInterval", "Standard deviation bootstrap confidence interval (percentile)" },
+	{ "standardDeviationBasicBootstrapInterval", "Standard deviation bootstrap confidence interval (basic)" },
+	{ "standardDeviationBcaBootstrapInterval", "Standard deviation bootstrap confidence interval (BCa)" },
+};
+
+// Statistics each confidence interval is computed from.
+const std::map<std::string, std::vector<std::string>> intervalsDependencies{
+	{ "meanConfidenceIntervalWithKnownVariance", { "sampleSize", "mean" } },
+	{ "meanConfidenceIntervalWithUnknownVariance", { "sampleSize", "mean", "unbiasedVariance" } },
+	{ "varianceConfidenceInterval", { "sampleSize", "unbiasedVariance" } },
+};
 
-	sample["params"]["sampleSize"] = sampleSize<FloatType>(varSeries);
-}
 
-void calculateStatistics(json& sample) {
-	if (sample.contains("values")) {
-		auto&& varSeries = makeVarSeries<FloatType>(sample["values"]);
-		calculateStatistics(sample, varSeries);
-	} else if(sample.contains("variationalSeries")) {
-		std::map<std::string, FloatType> keysValues = sample["variationalSeries"].get<std::map<std::string, FloatType>>();
-		auto varSeries = keysValues | std::views::transform(
-			[](auto keyValue) -> std::pair<FloatType, FloatType> { return { std::stod(keyValue.first), keyValue.second}; }
-		);
-		calculateStatistics(sample, varSeries);
+enum class OutputFormat { Text, Json, Ndjson };
+
+struct RunOptions {
+	OutputFormat format = OutputFormat::Text;
+	// Reported statistics, a subset of statisticsNames and extraStatisticsNames.
+	std::vector<std::pair<std::string, std::string>> statisticsNames = ::statisticsNames;
+	QuantileMethod quantileMethod = QuantileMethod::Exact;
+	// Number of bootstrap resamples; no bootstrap intervals are computed when zero.
+	std::size_t bootstrapReplicates = 0;
+	// Computes the median interval of every sample with raw data, not only of those that request it.
+	bool medianInterval = false;
+	// Seed of the generated samples and of the bootstrap resampling.
+	std::uint64_t seed = 0;
+};
+
+struct IntervalResult {
+	std::string name;
+	ConfidenceInterval interval;
+	FloatType confidence;
+};
+
+
+// Confidence intervals requested by the sample, in the order of intervalsNames.
+std::vector<IntervalResult> calculateIntervals(json& sample, QuantileMethod quantileMethod) {
+	std::vector<IntervalResult> intervals;
+
+	if (sample["meanConfidenceIntervalWithKnownVariance"].get<bool>()) {
+		FloatType sampleSize = sample["params"]["sampleSize"];
+		FloatType statMean = sample["statistics"]["mean"];
+		FloatType variance = sample["params"]["variance"];
+		FloatType confidence = sample["confidence"];
+
+		auto interval = meanConfidenceIntervalWithKnownVariance(sampleSize, statMean, variance, confidence, quantileMethod);
+		intervals.push_back({ "meanConfidenceIntervalWithKnownVariance", interval, confidence });
 	}
 
-	FloatType sampleSize = sample["params"]["sampleSize"];
-	if (sample["statistics"].contains("biasedVariance")) {
-		sample["statistics"]["unbiasedVariance"] = sample["statistics"]["biasedVariance"].get<FloatType>() * sampleSize / (sampleSize - 1);
-	} else if (sample["statistics"].contains("unbiasedVariance")) {
-		sample["statistics"]["biasedVariance"] = sample["statistics"]["unbiasedVariance"].get<FloatType>() * (sampleSize - 1) / sampleSize;
+	if (sample["meanConfidenceIntervalWithUnknownVariance"].get<bool>()) {
+		FloatType sampleSize = sample["params"]["sampleSize"];
+		FloatType statMean = sample["statistics"]["mean"];
+		FloatType statUnbiasedVariance = sample["statistics"]["unbiasedVariance"];
+		FloatType confidence = sample["confidence"];
+
+		auto interval = meanConfidenceIntervalWithUnknownVariance(sampleSize, statMean, statUnbiasedVariance, confidence, quantileMethod);
+		intervals.push_back({ "meanConfidenceIntervalWithUnknownVariance", interval, confidence });
 	}
 
-	if (sample["statistics"].contains("biasedVariance")) {
-		sample["statistics"]["biasedStandardDeviation"] = std::sqrt(sample["statistics"]["biasedVariance"].get<FloatType>());
-		sample["statistics"]["unbiasedStandardDeviation"] = std::sqrt(sample["statistics"]["unbiasedVariance"].get<FloatType>());
+	if (sample["varianceConfidenceInterval"].get<bool>()) {
+		FloatType sampleSize = sample["params"]["sampleSize"];
+		FloatType statUnbiasedVariance = sample["statistics"]["unbiasedVariance"];
+		FloatType confidence = sample["confidence"];
+
+		auto interval = varianceConfidenceInterval(sampleSize, statUnbiasedVariance, confidence, quantileMethod);
+		intervals.push_back({ "varianceConfidenceInterval", interval, confidence });
 	}
+
+	return intervals;
 }
 
 
-void printParam(const std::string& name, FloatType value) {
-	std::cout << std::format("{}: {:.8f}\n", name, value);
+// The median interval from the order statistics of samples whose raw values or variational series are held
+// in memory, at the sample's confidence or 0.95.
+std::vector<IntervalResult> calculateMedianInterval(const Sample& sample, const RunOptions& options, ThreadPool& pool) {
+	bool hasData = !sample.values.empty() || !sample.variationalSeries.empty();
+	if (!hasData || !(options.medianInterval || sample.data.value("medianConfidenceInterval", false))) return {};
+
+	FloatType confidence = sample.data.value("confidence", FloatType{ 0.95 });
+	// Samples too small for the confidence get an unavailable interval rather than losing the whole report.
+	ConfidenceInterval interval{ std::numeric_limits<FloatType>::quiet_NaN(), std::numeric_limits<FloatType>::quiet_NaN() };
+	try {
+		interval = sample.variationalSeries.empty()
+			? medianConfidenceInterval(sample.values, confidence, pool)
+			: medianConfidenceInterval(sample.variationalSeries, confidence);
+	} catch (const std::invalid_argument&) {}
+	return { { "medianConfidenceInterval", interval, confidence } };
 }
 
-int main()
-{
-	auto sample = loadSample();
-	calculateStatistics(sample);
 
-	std::cout << "Known parameters:\n";
+// Bootstrap intervals of samples whose raw values or variational series are held in memory,
+// at the sample's confidence or 0.95.
+std::vector<IntervalResult> calculateBootstrapIntervals(const Sample& sample, const RunOptions& options, ThreadPool& pool) {
+	bool hasData = !sample.values.empty() || !sample.variationalSeries.empty();
+	if (options.bootstrapReplicates == 0 || !hasData || sample.data["params"].value("sampleSize", FloatType{ 0 }) < 3) return {};
+
+	FloatType confidence = sample.data.value("confidence", FloatType{ 0.95 });
+	auto report = sample.variationalSeries.empty()
+		? bootstrapConfidenceIntervals(sample.values, confidence, options.bootstrapReplicates, options.seed, pool)
+		: bootstrapConfidenceIntervals(sample.variationalSeries, confidence, options.bootstrapReplicates, options.seed, pool);
+
+	std::vector<IntervalResult> intervals;
+	for (const auto& [statistic, statisticIntervals] : { std::pair{ "mean", report.mean }, std::pair{ "variance", report.unbiasedVariance },
+		std::pair{ "standardDeviation", report.unbiasedStandardDeviation } }
+	) {
+		intervals.push_back({ std::format("{}PercentileBootstrapInterval", statistic), statisticIntervals.percentile, confidence });
+		intervals.push_back({ std::format("{}BasicBootstrapInterval", statistic), statisticIntervals.basic, confidence });
+		intervals.push_back({ std::format("{}BcaBootstrapInterval", statistic), statisticIntervals.bca, confidence });
+	}
+	return intervals;
+}
+
+
+void printParam(std::ostream& out, const std::string& name, FloatType value) {
+	out << std::format("{}: {:.8f}\n", name, value);
+}
+
+void printReport(std::ostream& out, json& sample, const std::vector<IntervalResult>& intervals, const RunOptions& options) {
+	out << "Known parameters:\n";
 	for (const auto& [param, name] : paramsNames) {
 		if (!sample.contains("params")) break;
 		if (sample["params"].contains(param)) {
-			printParam(name, sample["params"][param].get<FloatType>());
+			printParam(out, name, sample["params"][param].get<FloatType>());
 		}
 	}
 
-	std::cout << "\nKnown statistics:\n";
-	for (const auto& [statistic, name] : statisticsNames) {
+	out << "\nKnown statistics:\n";
+	for (const auto& [statistic, name] : options.statisticsNames) {
 		if (!sample.contains("statistics")) break;
 		if (sample["statistics"].contains(statistic)) {
-			printParam(name, sample["statistics"][statistic].get<FloatType>());
+			printParam(out, name, sample["statistics"][statistic].get<FloatType>());
+		}
+	}
+	out << "\n\n";
+
+	for (const auto& [intervalName, name] : intervalsNames) {
+		for (const auto& result : intervals) {
+			if (result.name != intervalName) continue;
+			if (std::isnan(result.interval.lower)) {
+				out << std::format("{}: unavailable, confidence = {:.2f}\n", name, result.confidence);
+				continue;
+			}
+			out << std::format("{}: ({:.8f}, {:.8f}), confidence = {:.2f}\n",
+				name, result.interval.lower, result.interval.upper, result.confidence);
 		}
 	}
-	std::cout << "\n\n";
+}
 
 
-	if (sample["meanConfidenceIntervalWithKnownVariance"].get<bool>()) {
-		FloatType sampleSize = sample["params"]["sampleSize"];
-		FloatType statMean = sample["statistics"]["mean"];
-		FloatType variance = sample["params"]["variance"];
-		FloatType confidence = sample["confidence"];
+void writeRecordSection(JsonWriter& writer, json& sample, const std::string& section,
+	const std::vector<std::pair<std::string, std::string>>& names
+) {
+	writer.key(section).beginObject();
+	if (sample.contains(section)) {
+		for (const auto& [key, name] : names) {
+			if (sample[section].contains(key)) writer.key(key).value(sample[section][key].get<FloatType>());
+		}
+	}
+	writer.endObject();
+}
 
-		auto interval = meanConfidenceIntervalWithKnownVariance(sampleSize, statMean, variance, confidence);
-		std::cout << std::format("Mean confidence interval (with known variance): ({:.8f}, {:.8f}), confidence = {:.2f}\n",
-			interval.first, interval.second, confidence);
+void writeRecord(JsonWriter& writer, const std::filesystem::path& sampleFile, json& sample, const std::vector<IntervalResult>& intervals,
+	const RunOptions& options
+) {
+	writer.beginObject();
+	writer.key("sample").value(sampleFile.string());
+	writeRecordSection(writer, sample, "params", paramsNames);
+	writeRecordSection(writer, sample, "statistics", options.statisticsNames);
+	writer.key("intervals").beginObject();
+	for (const auto& result : intervals) {
+		writer.key(result.name).beginObject()
+			.key("lower").value(result.interval.lower)
+			.key("upper").value(result.interval.upper)
+			.key("confidence").value(result.confidence)
+			.endObject();
 	}
+	writer.endObject();
+	writer.endObject();
+}
+
+void writeErrorRecord(std::ostream& out, const std::filesystem::path& sampleFile, std::string_view error) {
+	JsonWriter(out).beginObject().key("sample").value(sampleFile.string()).key("error").value(error).endObject();
+}
 
-	if (sample["meanConfidenceIntervalWithUnknownVariance"].get<bool>()) {
-		FloatType sampleSize = sample["params"]["sampleSize"];
-		FloatType statMean = sample["statistics"]["mean"];
-		FloatType statUnbiasedVariance = sample["statistics"]["unbiasedVariance"];
-		FloatType confidence = sample["confidence"];
 
-		auto interval = meanConfidenceIntervalWithUnknownVariance(sampleSize, statMean, statUnbiasedVariance, confidence);
-		std::cout << std::format("Mean confidence interval (with unknown variance): ({:.8f}, {:.8f}), confidence = {:.2f}\n",
-			interval.first, interval.second, confidence);
+// Formats the report or the JSON record of a loaded sample. Only the reported statistics
+// and those the requested intervals depend on are evaluated.
+std::string reportSample(const std::filesystem::path& sampleFile, Sample& loadedSample, const RunOptions& options, ThreadPool& pool) {
+	std::vector<std::string> statistics{ "sampleSize" };
+	for (const auto& [statistic, name] : options.statisticsNames) statistics.push_back(statistic);
+	for (const auto& [interval, dependencies] : intervalsDependencies) {
+		if (loadedSample.data.value(interval, false)) std::ranges::copy(dependencies, std::back_inserter(statistics));
 	}
+	calculateStatistics(loadedSample, statistics, pool);
+	auto intervals = calculateIntervals(loadedSample.data, options.quantileMethod);
+	std::ranges::move(calculateMedianInterval(loadedSample, options, pool), std::back_inserter(intervals));
+	std::ranges::move(calculateBootstrapIntervals(loadedSample, options, pool), std::back_inserter(intervals));
+
+	std::ostringstream report;
+	if (options.format == OutputFormat::Text) {
+		printReport(report, loadedSample.data, intervals, options);
+	} else {
+		JsonWriter writer(report);
+		writeRecord(writer, sampleFile, loadedSample.data, intervals, options);
+	}
+	return report.str();
+}
 
-	if (sample["varianceConfidenceInterval"].get<bool>()) {
-		FloatType sampleSize = sample["params"]["sampleSize"];
-		FloatType statUnbiasedVariance = sample["statistics"]["unbiasedVariance"];
-		FloatType confidence = sample["confidence"];
+std::string processSample(const std::filesystem::path& sampleFile, const RunOptions& options, ThreadPool& pool) {
+	auto loadedSample = loadSample(sampleFile, pool);
+	return reportSample(sampleFile, loadedSample, options, pool);
+}
+
+
+// Directories are expanded to the files they contain, in path order.
+std::vector<std::filesystem::path> expandSamplePaths(const std::vector<std::filesystem::path>& paths) {
+	std::vector<std::filesystem::path> sampleFiles;
+	for (const auto& path : paths) {
+		if (!std::filesystem::is_directory(path)) {
+			sampleFiles.push_back(path);
+			continue;
+		}
+		std::vector<std::filesystem::path> directoryFiles;
+		for (const auto& entry : std::filesystem::directory_iterator(path)) {
+			if (entry.is_regular_file()) directoryFiles.push_back(entry.path());
+		}
+		std::ranges::sort(directoryFiles);
+		std::ranges::copy(directoryFiles, std::back_inserter(sampleFiles));
+	}
+	return sampleFiles;
+}
 
-		auto interval = varianceConfidenceInterval(sampleSize, statUnbiasedVariance, confidence);
-		std::cout << std::format("Variance condifence interval: ({:.8f}, {:.8f}), confidence = {:.2f}\n",
-			interval.first, interval.second, confidence);
+// Every sample is a task on the pool; the largest files are scheduled first so that the small ones
+// fill the remaining cores. Results are written in the order of the paths as soon as they are ready,
+// as text reports, a JSON array of records or one record per line.
+int processSamples(const std::vector<std::filesystem::path>& sampleFiles, const RunOptions& options, ThreadPool& pool) {
+	auto format = options.format;
+	std::vector<std::uintmax_t> fileSizes;
+	for (const auto& sampleFile : sampleFiles) {
+		std::error_code error;
+		auto fileSize = std::filesystem::file_size(sampleFile, error);
+		fileSizes.push_back(error ? 0 : fileSize);
+	}
+	std::vector<std::size_t> schedule(sampleFiles.size());
+	std::iota(schedule.begin(), schedule.end(), 0);
+	std::ranges::stable_sort(schedule, std::greater{}, [&](std::size_t index) { return fileSizes[index]; });
+
+	std::vector<std::future<std::string>> results(sampleFiles.size());
+	for (std::size_t index : schedule) {
+		results[index] = pool.submit([&pool, &options, sampleFile = sampleFiles[index]] {
+			return processSample(sampleFile, options, pool);
+		});
+	}
+
+	int exitCode = 0;
+	if (format == OutputFormat::Json) std::cout << "[\n";
+	for (std::size_t index = 0; index < sampleFiles.size(); index++) {
+		const auto& sampleFile = sampleFiles[index];
+		if (format == OutputFormat::Text) std::cout << std::format("Sample: {}\n", sampleFile.string());
+		try {
+			std::cout << pool.wait(results[index]);
+		} catch (const std::exception& error) {
+			std::cerr << std::format("Failed to process {}: {}\n", sampleFile.string(), error.what());
+			exitCode = 1;
+			if (format == OutputFormat::Text) continue;
+			writeErrorRecord(std::cout, sampleFile, error.what());
+		}
+		if (format == OutputFormat::Json && index + 1 < sampleFiles.size()) std::cout << ",";
+		std::cout << "\n";
+		std::cout.flush();
 	}
+	if (format == OutputFormat::Json) std::cout << "]\n";
+	return exitCode;
+}
+
+
+// Parameters of each distribution that can be generated, in the order of their fields.
+const std::map<std::string, std::vector<std::pair<std::string, FloatType>>> distributionsParameters{
+	{ "normal", { { "mean", 0 }, { "standardDeviation", 1 } } },
+	{ "exponential", { { "rate", 1 } } },
+	{ "poisson", { { "mean", 1 } } },
+	{ "hypergeometric", { { "population", 1 }, { "successes", 0 }, { "draws", 0 } } },
+};
+
+struct GenerateOptions {
+	std::string distribution;
+	std::uint64_t size = 0;
+	// Number of samples of the given size drawn to simulate the coverage of the intervals; none when generating a sample.
+	std::uint64_t replicates = 0;
+	// Given as name=value arguments; omitted parameters take the defaults from distributionsParameters.
+	std::map<std::string, FloatType> parameters;
+	// Enables every confidence interval of a generated sample.
+	std::optional<FloatType> confidence;
+	std::optional<std::filesystem::path> savePath;
+};
+
+
+SampleDistribution parseDistribution(const GenerateOptions& generateOptions) {
+	auto known = distributionsParameters.find(generateOptions.distribution);
+	if (known == distributionsParameters.end()) throw std::runtime_error(std::format("Unknown distribution {}", generateOptions.distribution));
+
+	std::vector<FloatType> values;
+	for (const auto& [parameter, defaultValue] : known->second) {
+		auto given = generateOptions.parameters.find(parameter);
+		values.push_back(given == generateOptions.parameters.end() ? defaultValue : given->second);
+	}
+	for (const auto& [parameter, value] : generateOptions.parameters) {
+		if (std::ranges::find(known->second, parameter, &std::pair<std::string, FloatType>::first) == known->second.end()) {
+			throw std::runtime_error(std::format("Unknown parameter {} of {} distribution", parameter, generateOptions.distribution));
+		}
+	}
+
+	auto count = [](FloatType value) {
+		if (!(value >= 0 && value < 0x1p64 && value == std::floor(value))) throw std::runtime_error(std::format("{} is not a count", value));
+		return static_cast<std::uint64_t>(value);
+	};
+	if (generateOptions.distribution == "normal") return NormalDistribution{ values[0], values[1] };
+	if (generateOptions.distribution == "exponential") return ExponentialDistribution{ values[0] };
+	if (generateOptions.distribution == "poisson") return PoissonDistribution{ values[0] };
+	return HypergeometricDistribution{ count(values[0]), count(values[1]), count(values[2]) };
+}
+
+// Generates a sample with the distribution's mean and variance as its known parameters and either saves it
+// or reports on it. Reports stream the sample into the moments and, when quantiles are reported, a quantile
+// sketch, or for discrete distributions into a variational series, without storing it.
+int processGeneratedSample(const GenerateOptions& generateOptions, const RunOptions& options, ThreadPool& pool) {
+	SampleGenerator generator(parseDistribution(generateOptions), options.seed);
+
+	json description{
+		{ "meanConfidenceIntervalWithKnownVariance", generateOptions.confidence.has_value() },
+		{ "meanConfidenceIntervalWithUnknownVariance", generateOptions.confidence.has_value() },
+		{ "varianceConfidenceInterval", generateOptions.confidence.has_value() },
+		{ "medianConfidenceInterval", generateOptions.confidence.has_value() },
+		{ "params", { { "mean", generator.mean() }, { "variance", generator.variance() } } },
+	};
+	if (generateOptions.confidence) description["confidence"] = *generateOptions.confidence;
+
+	// Saved samples carry their moments, which takes one more cheap generation pass for continuous distributions.
+	if (generateOptions.savePath) {
+		if (generator.isDiscrete()) {
+			auto series = generateVariationalSeries(generator, generateOptions.size, pool);
+			description["statistics"]["moments"] = variationalSeriesMoments(series, pool);
+			saveSample(*generateOptions.savePath, description, series);
+		} else {
+			description["statistics"]["moments"] = generatedSampleMoments(generator, generateOptions.size, pool);
+			saveSample(*generateOptions.savePath, description, generateOptions.size, [&](std::uint64_t first, std::span<FloatType> block) {
+				generateSample(generator, first, block, pool);
+			}, pool);
+		}
+		return 0;
+	}
+
+	Sample sample;
+	sample.data = std::move(description);
+	sample.hasRawData = true;
+	if (generator.isDiscrete()) {
+		sample.variationalSeries = generateVariationalSeries(generator, generateOptions.size, pool);
+	} else if (std::ranges::any_of(options.statisticsNames, [](const auto& statistic) { return isQuantileStatistic(statistic.first); })) {
+		auto summary = generatedSampleSummary(generator, generateOptions.size, pool);
+		sample.moments = summary.moments;
+		sample.quantiles = std::move(summary.quantiles);
+	} else {
+		sample.moments = generatedSampleMoments(generator, generateOptions.size, pool);
+	}
+	std::cout << reportSample(generateOptions.distribution, sample, options, pool);
+	if (options.format != OutputFormat::Text) std::cout << "\n";
+	return 0;
+}
+
+
+// Reports how often each confidence interval covers the true parameter over the replicates.
+int processCoverageSimulation(const GenerateOptions& generateOptions, const RunOptions& options, ThreadPool& pool) {
+	SampleGenerator generator(parseDistribution(generateOptions), options.seed);
+	FloatType confidence = generateOptions.confidence.value_or(0.95);
+	auto report = simulateCoverage(generator, generateOptions.size, generateOptions.replicates, confidence, pool, options.quantileMethod);
+	std::vector<std::pair<std::string, CoverageEstimate>> estimates{
+		{ "meanConfidenceIntervalWithKnownVariance", report.meanWithKnownVariance },
+		{ "meanConfidenceIntervalWithUnknownVariance", report.meanWithUnknownVariance },
+		{ "varianceConfidenceInterval", report.variance },
+	};
+
+	if (options.format == OutputFormat::Text) {
+		std::cout << std::format("Coverage over {} samples of size {}, confidence = {:.2f}:\n",
+			generateOptions.replicates, generateOptions.size, confidence);
+		// Only the classical intervals are simulated, the others have no estimate to report.
+		for (const auto& [interval, name] : intervalsNames) {
+			auto found = std::ranges::find(estimates, interval, &std::pair<std::string, CoverageEstimate>::first);
+			if (found == estimates.end()) continue;
+			const auto& estimate = found->second;
+			std::cout << std::format("{}: {:.8f} (standard error {:.8f})\n", name, estimate.coverage, estimate.standardError);
+		}
+		return 0;
+	}
+
+	JsonWriter writer(std::cout);
+	writer.beginObject()
+		.key("distribution").value(generateOptions.distribution)
+		.key("sampleSize").value(static_cast<FloatType>(generateOptions.size))
+		.key("replicates").value(static_cast<FloatType>(generateOptions.replicates))
+		.key("confidence").value(confidence)
+		.key("coverage").beginObject();
+	for (const auto& [interval, estimate] : estimates) {
+		writer.key(interval).beginObject()
+			.key("coverage").value(estimate.coverage)
+			.key("standardError").value(estimate.standardError)
+			.endObject();
+	}
+	writer.endObject().endObject();
+	std::cout << "\n";
+	return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+	std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::filesystem::path> samplePaths;
+	RunOptions options;
+	std::optional<GenerateOptions> generateOptions;
+	for (int i = 1; i < argc; i++) {
+		std::string_view argument = argv[i];
+		if (argument == "--threads" && i + 1 < argc) {
+			threadCount = std::max(1, std::stoi(argv[++i]));
+		} else if (argument == "--convert" && i + 1 < argc) {
+			std::filesystem::path input = argv[++i];
+			auto output = i + 1 < argc ? std::filesystem::path(argv[++i]) : std::filesystem::path(input).replace_extension(".bsample");
+			ThreadPool pool(threadCount);
+			convertToBinarySample(input, output, pool);
+			return 0;
+		} else if (argument == "--append" && i + 2 < argc) {
+			std::filesystem::path sampleFile = argv[++i], appendedFile = argv[++i];
+			ThreadPool pool(threadCount);
+			try {
+				appendToSample(sampleFile, loadSample(appendedFile, pool, true), pool);
+			} catch (const std::exception& error) {
+				std::cerr << std::format("Failed to append {} to {}: {}\n", appendedFile.string(), sampleFile.string(), error.what());
+				return 1;
+			}
+			return 0;
+		} else if (argument == "--output" && i + 1 < argc) {
+			std::string_view formatName = argv[++i];
+			if (formatName == "text") options.format = OutputFormat::Text;
+			else if (formatName == "json") options.format = OutputFormat::Json;
+			else if (formatName == "ndjson") options.format = OutputFormat::Ndjson;
+			else {
+				std::cerr << std::format("Unknown output format: {}\n", formatName);
+				return 1;
+			}
+		} else if (argument == "--statistics" && i + 1 < argc) {
+			options.statisticsNames.clear();
+			for (auto statistic : std::string_view(argv[++i]) | std::views::split(',')) {
+				std::string_view statisticName(statistic.begin(), statistic.end());
+				auto known = std::ranges::find(statisticsNames, statisticName, &std::pair<std::string, std::string>::first);
+				auto knownExtra = std::ranges::find(extraStatisticsNames, statisticName, &std::pair<std::string, std::string>::first);
+				if (known == statisticsNames.end() && knownExtra == extraStatisticsNames.end()) {
+					std::cerr << std::format("Unknown statistic: {}\n", statisticName);
+					return 1;
+				}
+				options.statisticsNames.push_back(known != statisticsNames.end() ? *known : *knownExtra);
+			}
+		} else if (argument == "--fast-quantiles") {
+			options.quantileMethod = QuantileMethod::Fast;
+		} else if ((argument == "generate" || argument == "simulate") && !generateOptions && i + 2 + (argument == "simulate") < argc) {
+			generateOptions.emplace();
+			generateOptions->distribution = argv[++i];
+			generateOptions->size = std::stoull(argv[++i]);
+			if (argument == "simulate") generateOptions->replicates = std::max(1ull, std::stoull(argv[++i]));
+			while (i + 1 < argc && std::string_view(argv[i + 1]).find('=') != std::string_view::npos) {
+				std::string_view parameter = argv[++i];
+				auto separator = parameter.find('=');
+				generateOptions->parameters[std::string(parameter.substr(0, separator))] = std::stod(std::string(parameter.substr(separator + 1)));
+			}
+		} else if (argument == "--seed" && i + 1 < argc) {
+			options.seed = std::stoull(argv[++i]);
+		} else if (argument == "--bootstrap" && i + 1 < argc) {
+			options.bootstrapReplicates = std::stoull(argv[++i]);
+		} else if (argument == "--median-interval") {
+			options.medianInterval = true;
+		} else if (argument == "--confidence" && generateOptions && i + 1 < argc) {
+			generateOptions->confidence = std::stod(argv[++i]);
+		} else if (argument == "--save" && generateOptions && i + 1 < argc) {
+			generateOptions->savePath = argv[++i];
+		} else if (argument == "--all") {
+			samplePaths.push_back("samples");
+		} else if (!argument.starts_with("--")) {
+			samplePaths.push_back(argv[i]);
+		} else {
+			std::cerr << std::format("Unknown argument: {}\n", argument);
+			std::cerr << "Usage: ProbabilitiesLab5 [--threads N] [--output text|json|ndjson] [--statistics <name>,...]\n"
+				"                         [--fast-quantiles] [--bootstrap B [--seed S]] [--median-interval] [--all | <sample or directory>...]\n";
+			std::cerr << "       ProbabilitiesLab5 --convert <sample.json> [<sample.bsample>]\n";
+			std::cerr << "       ProbabilitiesLab5 --append <sample> <appended sample>\n";
+			std::cerr << "       ProbabilitiesLab5 [--threads N] [--output ...] generate <normal|exponential|poisson|hypergeometric> <size>\n"
+				"                         [<parameter>=<value>...] [--seed S] [--confidence C] [--save <sample.json|sample.bsample>]\n";
+			std::cerr << "       ProbabilitiesLab5 [--threads N] [--output ...] [--fast-quantiles] simulate <distribution> <size> <replicates>\n"
+				"                         [<parameter>=<value>...] [--seed S] [--confidence C]\n";
+			return 1;
+		}
+	}
+	ThreadPool pool(threadCount);
+
+	if (generateOptions) {
+		try {
+			if (generateOptions->replicates != 0) return processCoverageSimulation(*generateOptions, options, pool);
+			return processGeneratedSample(*generateOptions, options, pool);
+		} catch (const std::exception& error) {
+			std::cerr << std::format("Failed to generate samples: {}\n", error.what());
+			return 1;
+		}
+	}
+
+	if (!samplePaths.empty()) {
+		return processSamples(expandSamplePaths(samplePaths), options, pool);
+	}
+
+	// Keep stdout machine-readable by prompting on stderr.
+	auto sampleFile = chooseSampleFile(options.format == OutputFormat::Text ? std::cout : std::cerr);
+	std::cout << processSample(sampleFile, options, pool);
+	if (options.format != OutputFormat::Text) std::cout << "\n";
 
 	return 0;
 }
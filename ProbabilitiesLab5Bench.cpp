@@ -0,0 +1,385 @@
+﻿#include <random>
+#include <filesystem>
+#include <format>
+
+#include <benchmark/benchmark.h>
+
+#include <boost/math/distributions/normal.hpp>
+#include <boost/math/distributions/students_t.hpp>
+#include <boost/math/distributions/chi_squared.hpp>
+
+#include "Sample.h"
+
+
+using namespace probstats;
+
+
+struct RawValues {};
+struct VariationalSeries {};
+
+// Benchmark samples are generated once per type and size; only the latest size is kept to bound memory use.
+template<std::floating_point T>
+const std::vector<T>& benchmarkValues(std::size_t size) {
+	static std::vector<T> values;
+	if (values.size() != size) {
+		std::mt19937_64 generator(size);
+		std::normal_distribution<T> distribution(3, 2);
+		values.resize(size);
+		for (auto& value : values) value = distribution(generator);
+	}
+	return values;
+}
+
+template<std::floating_point T>
+const std::vector<std::pair<T, T>>& benchmarkSeries(std::size_t size) {
+	static std::vector<std::pair<T, T>> series;
+	if (series.size() != size) {
+		std::mt19937_64 generator(size);
+		std::uniform_int_distribution<int> amounts(1, 1000);
+		series.resize(size);
+		for (std::size_t value = 0; value < size; value++) series[value] = { static_cast<T>(value), static_cast<T>(amounts(generator)) };
+	}
+	return series;
+}
+
+template<std::floating_point T, class Storage>
+const auto& benchmarkSample(std::size_t size) {
+	if constexpr (std::same_as<Storage, RawValues>) return benchmarkValues<T>(size);
+	else return benchmarkSeries<T>(size);
+}
+
+template<std::ranges::sized_range Range>
+void setThroughput(benchmark::State& state, const Range& sample) {
+	auto size = static_cast<std::int64_t>(std::ranges::size(sample));
+	state.SetItemsProcessed(state.iterations() * size);
+	state.SetBytesProcessed(state.iterations() * size * sizeof(std::ranges::range_value_t<Range>));
+}
+
+
+template<std::floating_point T, class Storage>
+void BM_SampleMoments(benchmark::State& state) {
+	const auto& sample = benchmarkSample<T, Storage>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(sampleMoments<T>(sample));
+	setThroughput(state, sample);
+}
+
+template<std::floating_point T, class Storage>
+void BM_SampleHigherMoments(benchmark::State& state) {
+	const auto& sample = benchmarkSample<T, Storage>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(sampleMoments<T, true>(sample));
+	setThroughput(state, sample);
+}
+
+template<std::floating_point T, class Storage>
+void BM_SampleMean(benchmark::State& state) {
+	const auto& sample = benchmarkSample<T, Storage>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(sampleMean<T>(sample));
+	setThroughput(state, sample);
+}
+
+template<std::floating_point T, class Storage>
+void BM_BiasedSampleVariance(benchmark::State& state) {
+	const auto& sample = benchmarkSample<T, Storage>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(biasedSampleVariance<T>(sample));
+	setThroughput(state, sample);
+}
+
+template<std::floating_point T, class Storage>
+void BM_ParallelSampleMoments(benchmark::State& state) {
+	const auto& sample = benchmarkSample<T, Storage>(state.range(0));
+	ThreadPool pool(state.range(1));
+	for (auto _ : state) benchmark::DoNotOptimize(parallelSampleMoments<T>(pool, sample));
+	setThroughput(state, sample);
+}
+
+template<std::floating_point T>
+void BM_ExactIntegerMoments(benchmark::State& state) {
+	const auto& sample = benchmarkSeries<T>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(exactIntegerMoments<T>(sample));
+	setThroughput(state, sample);
+}
+
+#define SAMPLE_BENCHMARK(name, T, Storage, maxSize) \
+	BENCHMARK_TEMPLATE(name, T, Storage)->RangeMultiplier(100)->Range(100, maxSize)->Unit(benchmark::kMicrosecond)
+
+SAMPLE_BENCHMARK(BM_SampleMoments, double, RawValues, 100'000'000);
+SAMPLE_BENCHMARK(BM_SampleMoments, float, RawValues, 100'000'000);
+SAMPLE_BENCHMARK(BM_SampleMoments, double, VariationalSeries, 1'000'000);
+SAMPLE_BENCHMARK(BM_SampleMoments, float, VariationalSeries, 1'000'000);
+SAMPLE_BENCHMARK(BM_SampleHigherMoments, double, RawValues, 100'000'000);
+SAMPLE_BENCHMARK(BM_SampleHigherMoments, double, VariationalSeries, 1'000'000);
+SAMPLE_BENCHMARK(BM_SampleMean, double, RawValues, 100'000'000);
+SAMPLE_BENCHMARK(BM_SampleMean, float, RawValues, 100'000'000);
+SAMPLE_BENCHMARK(BM_SampleMean, double, VariationalSeries, 1'000'000);
+SAMPLE_BENCHMARK(BM_BiasedSampleVariance, double, RawValues, 100'000'000);
+SAMPLE_BENCHMARK(BM_BiasedSampleVariance, float, RawValues, 100'000'000);
+SAMPLE_BENCHMARK(BM_BiasedSampleVariance, double, VariationalSeries, 1'000'000);
+BENCHMARK_TEMPLATE(BM_ParallelSampleMoments, double, RawValues)
+	->ArgsProduct({ { 1'000'000, 100'000'000 }, benchmark::CreateRange(1, 64, 2) })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_ExactIntegerMoments, double)->RangeMultiplier(100)->Range(100, 1'000'000)->Unit(benchmark::kMicrosecond);
+
+
+void BM_MeanConfidenceIntervalWithKnownVariance(benchmark::State& state) {
+	auto sampleSize = static_cast<FloatType>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(meanConfidenceIntervalWithKnownVariance(sampleSize, 3, 4, 0.95));
+}
+
+void BM_MeanConfidenceIntervalWithUnknownVariance(benchmark::State& state) {
+	auto sampleSize = static_cast<FloatType>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(meanConfidenceIntervalWithUnknownVariance(sampleSize, 3, 4, 0.95));
+}
+
+void BM_VarianceConfidenceInterval(benchmark::State& state) {
+	auto sampleSize = static_cast<FloatType>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(varianceConfidenceInterval(sampleSize, 4, 0.95));
+}
+
+BENCHMARK(BM_MeanConfidenceIntervalWithKnownVariance)->RangeMultiplier(100)->Range(100, 100'000'000);
+BENCHMARK(BM_MeanConfidenceIntervalWithUnknownVariance)->RangeMultiplier(100)->Range(100, 100'000'000);
+BENCHMARK(BM_VarianceConfidenceInterval)->RangeMultiplier(100)->Range(100, 100'000'000);
+
+
+struct BoostQuantiles {
+	static FloatType normal(FloatType probability) {
+		return boost::math::quantile(boost::math::normal(), probability);
+	}
+	static FloatType studentsT(FloatType degreesOfFreedom, FloatType probability) {
+		return boost::math::quantile(boost::math::students_t(degreesOfFreedom), probability);
+	}
+	static FloatType chiSquared(FloatType degreesOfFreedom, FloatType probability) {
+		return boost::math::quantile(boost::math::chi_squared(degreesOfFreedom), probability);
+	}
+};
+
+struct FastQuantiles {
+	static FloatType normal(FloatType probability) {
+		return fastNormalQuantile(probability);
+	}
+	static FloatType studentsT(FloatType degreesOfFreedom, FloatType probability) {
+		return fastStudentsTQuantile(degreesOfFreedom, probability);
+	}
+	static FloatType chiSquared(FloatType degreesOfFreedom, FloatType probability) {
+		return fastChiSquaredQuantile(degreesOfFreedom, probability);
+	}
+};
+
+// Uncached quantiles; the probability is read through a volatile so every iteration is evaluated.
+template<class Quantiles>
+void BM_NormalQuantile(benchmark::State& state) {
+	volatile FloatType probability = 0.975;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Quantiles::normal(probability));
+	}
+}
+
+template<class Quantiles>
+void BM_StudentsTQuantile(benchmark::State& state) {
+	auto degreesOfFreedom = static_cast<FloatType>(state.range(0));
+	volatile FloatType probability = 0.975;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Quantiles::studentsT(degreesOfFreedom, probability));
+	}
+}
+
+template<class Quantiles>
+void BM_ChiSquaredQuantile(benchmark::State& state) {
+	auto degreesOfFreedom = static_cast<FloatType>(state.range(0));
+	volatile FloatType probability = 0.975;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Quantiles::chiSquared(degreesOfFreedom, probability));
+	}
+}
+
+BENCHMARK_TEMPLATE(BM_NormalQuantile, BoostQuantiles);
+BENCHMARK_TEMPLATE(BM_NormalQuantile, FastQuantiles);
+BENCHMARK_TEMPLATE(BM_StudentsTQuantile, BoostQuantiles)->RangeMultiplier(100)->Range(10, 10'000'000);
+BENCHMARK_TEMPLATE(BM_StudentsTQuantile, FastQuantiles)->RangeMultiplier(100)->Range(10, 10'000'000);
+BENCHMARK_TEMPLATE(BM_ChiSquaredQuantile, BoostQuantiles)->RangeMultiplier(100)->Range(10, 10'000'000);
+BENCHMARK_TEMPLATE(BM_ChiSquaredQuantile, FastQuantiles)->RangeMultiplier(100)->Range(10, 10'000'000);
+
+
+// Batches of per-group sub-samples: sizes repeat across groups, as in per-customer or per-hour splits.
+struct IntervalBatch {
+	std::vector<FloatType> sampleSizes, means, variances, confidences, lowers, uppers;
+};
+
+IntervalBatch& benchmarkIntervalBatch(std::size_t size) {
+	static IntervalBatch batch;
+	if (batch.sampleSizes.size() != size) {
+		std::mt19937_64 generator(size);
+		std::uniform_int_distribution<int> sampleSizes(2, 500);
+		std::normal_distribution<FloatType> means(3, 2);
+		std::uniform_real_distribution<FloatType> variances(1, 4);
+		batch = {};
+		for (std::size_t i = 0; i < size; i++) {
+			batch.sampleSizes.push_back(sampleSizes(generator));
+			batch.means.push_back(means(generator));
+			batch.variances.push_back(variances(generator));
+			batch.confidences.push_back(i % 2 ? 0.95 : 0.99);
+		}
+		batch.lowers.resize(size);
+		batch.uppers.resize(size);
+	}
+	return batch;
+}
+
+void BM_MeanConfidenceIntervalsWithUnknownVariance(benchmark::State& state) {
+	auto& batch = benchmarkIntervalBatch(state.range(0));
+	for (auto _ : state) {
+		meanConfidenceIntervalsWithUnknownVariance(batch.sampleSizes, batch.means, batch.variances, batch.confidences, batch.lowers, batch.uppers);
+		benchmark::DoNotOptimize(batch.lowers.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_MeanConfidenceIntervalWithUnknownVarianceLoop(benchmark::State& state) {
+	auto& batch = benchmarkIntervalBatch(state.range(0));
+	for (auto _ : state) {
+		for (std::size_t i = 0; i < batch.sampleSizes.size(); i++) {
+			auto interval = meanConfidenceIntervalWithUnknownVariance(batch.sampleSizes[i], batch.means[i], batch.variances[i], batch.confidences[i]);
+			batch.lowers[i] = interval.lower;
+			batch.uppers[i] = interval.upper;
+		}
+		benchmark::DoNotOptimize(batch.lowers.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_VarianceConfidenceIntervals(benchmark::State& state) {
+	auto& batch = benchmarkIntervalBatch(state.range(0));
+	for (auto _ : state) {
+		varianceConfidenceIntervals(batch.sampleSizes, batch.variances, batch.confidences, batch.lowers, batch.uppers);
+		benchmark::DoNotOptimize(batch.lowers.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_MeanConfidenceIntervalsWithUnknownVariance)->RangeMultiplier(100)->Range(100, 1'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MeanConfidenceIntervalWithUnknownVarianceLoop)->RangeMultiplier(100)->Range(100, 1'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_VarianceConfidenceIntervals)->RangeMultiplier(100)->Range(100, 1'000'000)->Unit(benchmark::kMicrosecond);
+
+
+// Streams a generated sample of each distribution into its moments or variational series.
+template<class Distribution>
+void BM_GenerateSample(benchmark::State& state, Distribution distribution) {
+	ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	SampleGenerator generator(distribution, 1);
+	for (auto _ : state) {
+		if (generator.isDiscrete()) benchmark::DoNotOptimize(generateVariationalSeries(generator, state.range(0), pool));
+		else benchmark::DoNotOptimize(generatedSampleMoments(generator, state.range(0), pool));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_CAPTURE(BM_GenerateSample, Normal, NormalDistribution{ 3, 2 })->RangeMultiplier(100)->Range(100, 100'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_GenerateSample, Exponential, ExponentialDistribution{ 0.5 })->RangeMultiplier(100)->Range(100, 100'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_GenerateSample, Poisson, PoissonDistribution{ 1.5 })->RangeMultiplier(100)->Range(100, 100'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_GenerateSample, Hypergeometric, HypergeometricDistribution{ 500, 50, 40 })->RangeMultiplier(100)->Range(100, 100'000'000)->Unit(benchmark::kMicrosecond);
+
+
+void BM_SimulateCoverage(benchmark::State& state) {
+	ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	SampleGenerator generator(ExponentialDistribution{ 0.5 }, 1);
+	for (auto _ : state) benchmark::DoNotOptimize(simulateCoverage(generator, state.range(0), 10'000, 0.95, pool));
+	state.SetItemsProcessed(state.iterations() * 10'000);
+}
+
+BENCHMARK(BM_SimulateCoverage)->RangeMultiplier(10)->Range(10, 1'000)->Unit(benchmark::kMillisecond);
+
+
+template<class T, class Storage>
+void BM_Bootstrap(benchmark::State& state) {
+	ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	const auto& sample = benchmarkSample<T, Storage>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(bootstrapConfidenceIntervals(sample, 0.95, 1'000, 1, pool));
+	state.SetItemsProcessed(state.iterations() * 1'000);
+}
+
+BENCHMARK_TEMPLATE(BM_Bootstrap, double, RawValues)->RangeMultiplier(100)->Range(100, 100'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Bootstrap, double, VariationalSeries)->RangeMultiplier(100)->Range(100, 10'000)->Unit(benchmark::kMillisecond);
+
+
+void BM_QuantileSketch(benchmark::State& state) {
+	ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	const auto& sample = benchmarkValues<FloatType>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(parallelQuantileSketch(pool, sample));
+	setThroughput(state, sample);
+}
+
+void BM_VariationalSeriesSketch(benchmark::State& state) {
+	const auto& sample = benchmarkSeries<FloatType>(state.range(0));
+	for (auto _ : state) benchmark::DoNotOptimize(variationalSeriesSketch(sample));
+	setThroughput(state, sample);
+}
+
+BENCHMARK(BM_QuantileSketch)->RangeMultiplier(100)->Range(100, 100'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_VariationalSeriesSketch)->RangeMultiplier(100)->Range(100, 1'000'000)->Unit(benchmark::kMicrosecond);
+
+
+template<class T, class Storage>
+void BM_ExactQuantiles(benchmark::State& state) {
+	ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	const auto& sample = benchmarkSample<T, Storage>(state.range(0));
+	const FloatType probabilities[] = { 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99 };
+	for (auto _ : state) {
+		if constexpr (std::same_as<Storage, RawValues>) benchmark::DoNotOptimize(exactQuantiles(sample, probabilities, pool));
+		else benchmark::DoNotOptimize(exactQuantiles(sample, probabilities));
+	}
+	setThroughput(state, sample);
+}
+
+BENCHMARK_TEMPLATE(BM_ExactQuantiles, double, RawValues)->RangeMultiplier(100)->Range(100, 100'000'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_ExactQuantiles, double, VariationalSeries)->RangeMultiplier(100)->Range(100, 1'000'000)->Unit(benchmark::kMicrosecond);
+
+
+struct RadixSort {};
+struct ComparisonSort {};
+
+template<class Method>
+void BM_SortSample(benchmark::State& state) {
+	ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	const auto& sample = benchmarkValues<FloatType>(state.range(0));
+	std::vector<FloatType> sorted(sample.size());
+	RadixSorter sorter;
+	for (auto _ : state) {
+		std::ranges::copy(sample, sorted.begin());
+		if constexpr (std::same_as<Method, RadixSort>) sorter.sort(sorted, pool);
+		else std::ranges::sort(sorted);
+		benchmark::DoNotOptimize(sorted.data());
+	}
+	setThroughput(state, sample);
+}
+
+BENCHMARK_TEMPLATE(BM_SortSample, RadixSort)->RangeMultiplier(100)->Range(10'000, 100'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SortSample, ComparisonSort)->RangeMultiplier(100)->Range(10'000, 100'000'000)->Unit(benchmark::kMillisecond);
+
+
+// Loads every file in samples/ and evaluates all statistics, including parsing and the moments pass.
+void registerLoadSampleBenchmarks() {
+	if (!std::filesystem::is_directory("samples")) return;
+	for (const auto& entry : std::filesystem::directory_iterator("samples")) {
+		auto path = entry.path();
+		benchmark::RegisterBenchmark(std::format("BM_LoadSample/{}", path.filename().string()).c_str(), [path](benchmark::State& state) {
+			ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+			FloatType sampleSize = 0;
+			for (auto _ : state) {
+				auto sample = loadSample(path, pool);
+				calculateStatistics(sample, pool);
+				if (sample.moments) sampleSize = sample.moments->count;
+				benchmark::DoNotOptimize(sample);
+			}
+			state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(std::filesystem::file_size(path)));
+			state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(sampleSize));
+		})->Unit(benchmark::kMillisecond);
+	}
+}
+
+
+int main(int argc, char** argv) {
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+	registerLoadSampleBenchmarks();
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,142 @@
+﻿#include <random>
+#include <filesystem>
+#include <format>
+#include <fstream>
+
+#include "Sample.h"
+#include "Check.h"
+
+
+using namespace probstats;
+using namespace probstats::test;
+
+
+// Moments of the values from a two-pass sum in long double, for comparison with merged states.
+MomentAccumulator<FloatType, true> referenceMoments(std::span<const FloatType> values) {
+	long double sum = 0;
+	for (FloatType value : values) sum += value;
+	long double mean = sum / values.size(), m2 = 0, m3 = 0, m4 = 0;
+	for (FloatType value : values) {
+		long double deviation = value - mean;
+		m2 += deviation * deviation;
+		m3 += deviation * deviation * deviation;
+		m4 += deviation * deviation * deviation * deviation;
+	}
+	MomentAccumulator<FloatType, true> moments;
+	moments.count = static_cast<FloatType>(values.size());
+	moments.mean = static_cast<FloatType>(mean);
+	moments.m2 = static_cast<FloatType>(m2);
+	moments.m3 = static_cast<FloatType>(m3);
+	moments.m4 = static_cast<FloatType>(m4);
+	moments.min = *std::ranges::min_element(values);
+	moments.max = *std::ranges::max_element(values);
+	return moments;
+}
+
+void checkMoments(const MomentAccumulator<FloatType, true>& actual, const MomentAccumulator<FloatType, true>& expected, std::string_view name) {
+	constexpr FloatType tolerance = 1e-12;
+	check(actual.count == expected.count, std::format("{}: count", name));
+	check(isClose(actual.mean, expected.mean, tolerance), std::format("{}: mean", name));
+	check(isClose(actual.m2, expected.m2, tolerance), std::format("{}: m2", name));
+	// m3 nearly cancels for symmetric data, so it is compared on the scale of m2^(3/2) / sqrt(n).
+	check(std::abs(actual.m3 - expected.m3) <= tolerance * std::pow(expected.m2, 1.5) / std::sqrt(expected.count), std::format("{}: m3", name));
+	check(isClose(actual.m4, expected.m4, tolerance), std::format("{}: m4", name));
+	check(actual.min == expected.min && actual.max == expected.max, std::format("{}: extremes", name));
+}
+
+std::vector<FloatType> expandSeries(std::span<const std::pair<FloatType, FloatType>> series) {
+	std::vector<FloatType> values;
+	for (const auto& [value, amount] : series) values.insert(values.end(), static_cast<std::size_t>(amount), value);
+	return values;
+}
+
+// Appends to the sample at path and checks that the reloaded sample holds the old data followed by the
+// appended data, and that its stored moments match a recomputation over all of it.
+void checkAppend(const std::filesystem::path& path, const std::filesystem::path& appendedPath, bool binary,
+	std::vector<FloatType> expectedValues, ThreadPool& pool
+) {
+	auto name = path.filename().string();
+	auto appended = loadSample(appendedPath, pool, true);
+	appendToSample(path, appended, pool);
+
+	// JSON samples start with their description's brace, binary ones with the magic.
+	check((std::ifstream(path).get() != '{') == binary, std::format("{}: format", name));
+	auto sample = loadSample(path, pool, true);
+	std::vector<FloatType> values(sample.values.begin(), sample.values.end());
+	if (!sample.variationalSeries.empty()) {
+		values = expandSeries(sample.variationalSeries);
+		std::ranges::sort(expectedValues);
+	}
+	check(values == expectedValues, std::format("{}: values", name));
+	if (!sample.data.contains("statistics") || !sample.data["statistics"].contains("moments")) {
+		check(false, std::format("{}: stored moments", name));
+		return;
+	}
+	checkMoments(sample.data["statistics"]["moments"].get<MomentAccumulator<FloatType, true>>(), referenceMoments(expectedValues), name);
+	if (binary) check(sample.moments.has_value(), std::format("{}: stored moments cover the data", name));
+}
+
+void writeText(const std::filesystem::path& path, std::string_view text) {
+	std::ofstream(path, std::ios::binary) << text;
+}
+
+std::string jsonValues(std::span<const FloatType> values) {
+	std::string text = "{\"values\":[";
+	for (std::size_t i = 0; i < values.size(); i++) text += std::format("{}{}", i == 0 ? "" : ",", values[i]);
+	return text + "]}";
+}
+
+
+int main() {
+	ThreadPool pool(4);
+	auto directory = std::filesystem::temp_directory_path() / "ProbabilitiesLab5Tests";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	std::mt19937_64 generator(1);
+	std::normal_distribution<FloatType> distribution(3, 2);
+	std::vector<FloatType> oldValues(3000), newValues(1000);
+	for (auto& value : oldValues) value = distribution(generator);
+	for (auto& value : newValues) value = distribution(generator);
+	auto allValues = oldValues;
+	allValues.insert(allValues.end(), newValues.begin(), newValues.end());
+
+	auto appendedPath = directory / "appended.json";
+	writeText(appendedPath, jsonValues(newValues));
+
+	// A JSON sample read by the fast scanner.
+	writeText(directory / "values.json", jsonValues(oldValues));
+	checkAppend(directory / "values.json", appendedPath, false, allValues, pool);
+
+	// A JSON sample read through the SAX handler, since from_chars rejects 1e-400, which nlohmann reads as 0.
+	writeText(directory / "streamed.json", R"({"values":[1e-400, 1, 2]})");
+	checkAppend(directory / "streamed.json", appendedPath, false, [&] {
+		std::vector<FloatType> values{ 0, 1, 2 };
+		values.insert(values.end(), newValues.begin(), newValues.end());
+		return values;
+	}(), pool);
+
+	// A JSON variational series, to which the appended values are added as buckets.
+	writeText(directory / "series.json", R"({"variationalSeries":{"1":2,"3":1}})");
+	writeText(directory / "integers.json", R"({"values":[3,4,4]})");
+	checkAppend(directory / "series.json", directory / "integers.json", false, { 1, 1, 3, 3, 4, 4 }, pool);
+
+	// A binary sample with stored moments, appended to in place.
+	convertToBinarySample(directory / "values.json", directory / "values.bsample", pool);
+	auto inPlaceValues = allValues;
+	inPlaceValues.insert(inPlaceValues.end(), newValues.begin(), newValues.end());
+	checkAppend(directory / "values.bsample", appendedPath, true, inPlaceValues, pool);
+
+	// A binary sample without stored moments, which is rewritten.
+	saveSample(directory / "unsummarised.bsample", json::object(), oldValues.size(), [&](std::uint64_t first, std::span<FloatType> block) {
+		std::copy_n(oldValues.begin() + first, block.size(), block.begin());
+	}, pool);
+	checkAppend(directory / "unsummarised.bsample", appendedPath, true, allValues, pool);
+
+	// A binary variational series.
+	convertToBinarySample(directory / "series.json", directory / "series.bsample", pool);
+	checkAppend(directory / "series.bsample", directory / "integers.json", true, { 1, 1, 3, 3, 3, 4, 4, 4, 4 }, pool);
+
+	std::filesystem::remove_all(directory);
+	return failures;
+}
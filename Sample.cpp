@@ -0,0 +1,926 @@
+﻿#include "Sample.h"
+
+#include <fstream>
+#include <format>
+#include <bit>
+#include <cstring>
+#include <charconv>
+#include <string_view>
+#include <cctype>
+#include <numeric>
+#include <map>
+#include <functional>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+using namespace probstats;
+
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+	auto fileSize = std::filesystem::file_size(path);
+	if (fileSize == 0) return;
+#ifdef _WIN32
+	file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error(std::format("Cannot open {}", path.string()));
+	}
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) throw std::runtime_error(std::format("Cannot map {}", path.string()));
+	data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr) throw std::runtime_error(std::format("Cannot map {}", path.string()));
+#else
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) throw std::runtime_error(std::format("Cannot open {}", path.string()));
+	void* address = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (address == MAP_FAILED) throw std::runtime_error(std::format("Cannot map {}", path.string()));
+	data = static_cast<const std::byte*>(address);
+#endif
+	size = fileSize;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	swap(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	MappedFile(std::move(other)).swap(*this);
+	return *this;
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+#else
+	if (data) munmap(const_cast<std::byte*>(data), size);
+#endif
+}
+
+void MappedFile::swap(MappedFile& other) noexcept {
+	std::swap(data, other.data);
+	std::swap(size, other.size);
+	std::swap(file, other.file);
+	std::swap(mapping, other.mapping);
+}
+
+
+// Collects variational series buckets sorted by value. Non-negative integer values, as in
+// Poisson or hypergeometric samples, are counted in a dense array indexed by the value,
+// so such series need neither sorting nor merging of equal values.
+class VariationalSeriesBuilder {
+public:
+	void add(FloatType value, FloatType amount) {
+		if (value >= 0 && value < denseLimit && value == std::floor(value)) {
+			auto index = static_cast<std::size_t>(value);
+			if (index >= denseCounts.size()) denseCounts.resize(index + 1);
+			denseCounts[index] += amount;
+		} else {
+			sparseBuckets.emplace_back(value, amount);
+		}
+	}
+
+	std::vector<std::pair<FloatType, FloatType>> build() && {
+		std::vector<std::pair<FloatType, FloatType>> buckets;
+		for (std::size_t value = 0; value < denseCounts.size(); value++) {
+			if (denseCounts[value] != 0) buckets.emplace_back(static_cast<FloatType>(value), denseCounts[value]);
+		}
+		if (sparseBuckets.empty()) return buckets;
+
+		buckets.insert(buckets.end(), sparseBuckets.begin(), sparseBuckets.end());
+		std::ranges::sort(buckets, {}, &std::pair<FloatType, FloatType>::first);
+		std::vector<std::pair<FloatType, FloatType>> merged;
+		for (const auto& [value, amount] : buckets) {
+			if (!merged.empty() && merged.back().first == value) merged.back().second += amount;
+			else merged.emplace_back(value, amount);
+		}
+		return merged;
+	}
+
+private:
+	static constexpr FloatType denseLimit = 1 << 16;
+	std::vector<FloatType> denseCounts;
+	std::vector<std::pair<FloatType, FloatType>> sparseBuckets;
+};
+
+
+// Binary sample layout: header, the scalar part of the JSON description (flags, confidence,
+// params, statistics) as compact JSON text, padding up to dataOffset, then either elementCount
+// doubles or elementCount interleaved (value, amount) pairs of doubles, unless the sample has no data.
+enum class BinarySampleLayout : std::uint32_t { None = 0, Values = 1, VariationalSeries = 2 };
+
+struct BinarySampleHeader {
+	std::array<char, 8> magic;
+	std::uint32_t version;
+	BinarySampleLayout layout;
+	std::uint64_t elementCount;
+	std::uint64_t descriptionSize;
+	std::uint64_t dataOffset;
+};
+
+constexpr std::array<char, 8> binarySampleMagic{ 'P', 'L', '5', 'S', 'A', 'M', 'P', 'L' };
+constexpr std::uint32_t binarySampleVersion = 1;
+constexpr std::size_t binarySampleAlignment = 64;
+// Space left after the description, so that stored statistics can be updated in place.
+constexpr std::size_t binarySampleDescriptionReserve = 1024;
+
+bool isBinarySample(const std::filesystem::path& path) {
+	std::array<char, 8> magic{};
+	std::ifstream(path, std::ios::binary).read(magic.data(), magic.size());
+	return magic == binarySampleMagic;
+}
+
+Sample loadBinarySample(const std::filesystem::path& path) {
+	static_assert(std::endian::native == std::endian::little, "Binary samples are stored little-endian");
+
+	Sample sample;
+	sample.mapping = MappedFile(path);
+	auto bytes = sample.mapping.bytes();
+
+	BinarySampleHeader header;
+	if (bytes.size() < sizeof(header)) throw std::runtime_error(std::format("{} is truncated", path.string()));
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (header.magic != binarySampleMagic || header.version != binarySampleVersion) {
+		throw std::runtime_error(std::format("{} is not a supported binary sample", path.string()));
+	}
+
+	std::size_t valuesCount = header.elementCount * (header.layout == BinarySampleLayout::VariationalSeries ? 2 : 1);
+	if (header.dataOffset % alignof(FloatType) != 0 || sizeof(header) + header.descriptionSize > header.dataOffset
+		|| header.dataOffset + valuesCount * sizeof(FloatType) > bytes.size()) {
+		throw std::runtime_error(std::format("{} is truncated", path.string()));
+	}
+
+	auto description = bytes.subspan(sizeof(header), header.descriptionSize);
+	sample.data = json::parse(reinterpret_cast<const char*>(description.data()),
+		reinterpret_cast<const char*>(description.data() + description.size()));
+	sample.values = { reinterpret_cast<const FloatType*>(bytes.data() + header.dataOffset), valuesCount };
+
+	sample.hasRawData = header.layout != BinarySampleLayout::None;
+	if (header.layout == BinarySampleLayout::VariationalSeries) {
+		VariationalSeriesBuilder seriesBuilder;
+		for (std::size_t i = 0; i < header.elementCount; i++) seriesBuilder.add(sample.values[2 * i], sample.values[2 * i + 1]);
+		sample.variationalSeries = std::move(seriesBuilder).build();
+		sample.values = {};
+	}
+	return sample;
+}
+
+void writeBinarySampleHeader(std::ofstream& file, const json& description, BinarySampleLayout layout, std::uint64_t elementCount) {
+	std::string descriptionText = description.dump();
+	std::uint64_t dataOffset = (sizeof(BinarySampleHeader) + descriptionText.size() + binarySampleDescriptionReserve + binarySampleAlignment - 1)
+		/ binarySampleAlignment * binarySampleAlignment;
+	BinarySampleHeader header{ binarySampleMagic, binarySampleVersion, layout, elementCount, descriptionText.size(), dataOffset };
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(descriptionText.data(), descriptionText.size());
+	file.write(std::string(header.dataOffset - sizeof(header) - descriptionText.size(), '\0').data(), header.dataOffset - sizeof(header) - descriptionText.size());
+}
+
+void convertToBinarySample(const std::filesystem::path& input, const std::filesystem::path& output, ThreadPool& pool) {
+	json sample = json::parse(std::ifstream(input));
+
+	auto layout = BinarySampleLayout::None;
+	std::vector<double> data;
+	if (sample.contains("values")) {
+		layout = BinarySampleLayout::Values;
+		data = sample["values"].get<std::vector<double>>();
+		sample.erase("values");
+		sample["statistics"]["moments"] = parallelSampleMoments<FloatType, true>(pool, data);
+	} else if (sample.contains("variationalSeries")) {
+		layout = BinarySampleLayout::VariationalSeries;
+		std::vector<std::pair<FloatType, FloatType>> series;
+		for (const auto& [value, amount] : sample["variationalSeries"].items()) {
+			series.emplace_back(std::stod(value), amount.get<double>());
+			data.push_back(series.back().first);
+			data.push_back(series.back().second);
+		}
+		sample.erase("variationalSeries");
+		sample["statistics"]["moments"] = variationalSeriesMoments(series, pool);
+	}
+
+	std::ofstream file(output, std::ios::binary);
+	writeBinarySampleHeader(file, sample, layout, layout == BinarySampleLayout::VariationalSeries ? data.size() / 2 : data.size());
+	file.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(double));
+	if (!file) throw std::runtime_error(std::format("Cannot write {}", output.string()));
+}
+
+
+// JSON samples are written as the compact description with the data appended as its last member.
+void beginJsonSampleData(std::ofstream& file, const json& description, std::string_view dataKey) {
+	std::string descriptionText = description.dump();
+	descriptionText.pop_back();
+	file << descriptionText << (description.empty() ? "" : ",") << std::format("\"{}\":", dataKey);
+}
+
+void saveSample(const std::filesystem::path& path, const json& description, std::uint64_t valuesCount,
+	const std::function<void(std::uint64_t, std::span<FloatType>)>& fill, ThreadPool& pool
+) {
+	constexpr std::size_t blockSize = 1 << 20, formatChunkSize = 1 << 14;
+	bool binary = path.extension() == ".bsample";
+	std::ofstream file(path, std::ios::binary);
+	if (binary) writeBinarySampleHeader(file, description, BinarySampleLayout::Values, valuesCount);
+	else beginJsonSampleData(file, description, "values");
+
+	std::vector<FloatType> block;
+	std::vector<std::string> formattedChunks;
+	for (std::uint64_t first = 0; first < valuesCount; first += block.size()) {
+		block.resize(std::min<std::uint64_t>(blockSize, valuesCount - first));
+		fill(first, block);
+		if (binary) {
+			file.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(FloatType));
+			continue;
+		}
+
+		formattedChunks.resize((block.size() + formatChunkSize - 1) / formatChunkSize);
+		pool.parallelFor(formattedChunks.size(), [&](std::size_t chunk) {
+			auto& text = formattedChunks[chunk];
+			text.clear();
+			for (std::size_t i = chunk * formatChunkSize; i < std::min(block.size(), (chunk + 1) * formatChunkSize); i++) {
+				std::format_to(std::back_inserter(text), "{}{}", i == 0 && first == 0 ? "[" : ",", block[i]);
+			}
+		});
+		for (const auto& text : formattedChunks) file << text;
+	}
+	if (!binary) file << (valuesCount == 0 ? "[]}" : "]}");
+	if (!file) throw std::runtime_error(std::format("Cannot write {}", path.string()));
+}
+
+void saveSample(const std::filesystem::path& path, const json& description,
+	std::span<const std::pair<FloatType, FloatType>> variationalSeries
+) {
+	std::ofstream file(path, std::ios::binary);
+	if (path.extension() == ".bsample") {
+		writeBinarySampleHeader(file, description, BinarySampleLayout::VariationalSeries, variationalSeries.size());
+		file.write(reinterpret_cast<const char*>(variationalSeries.data()), variationalSeries.size_bytes());
+	} else {
+		beginJsonSampleData(file, description, "variationalSeries");
+		file << "{";
+		for (std::size_t i = 0; i < variationalSeries.size(); i++) {
+			file << std::format("{}\"{}\":{}", i == 0 ? "" : ",", variationalSeries[i].first, variationalSeries[i].second);
+		}
+		file << "}}";
+	}
+	if (!file) throw std::runtime_error(std::format("Cannot write {}", path.string()));
+}
+
+
+// Builds the sample description with nlohmann's DOM parser, but streams the top-level
+// "values" array straight into a moment accumulator and decodes the "variationalSeries"
+// object into numeric buckets, so that the data itself is never materialised as json nodes.
+// Unless keepValues is set, the values are reduced in blocks and not kept.
+class SampleSaxHandler {
+public:
+	using number_integer_t = json::number_integer_t;
+	using number_unsigned_t = json::number_unsigned_t;
+	using number_float_t = json::number_float_t;
+	using string_t = json::string_t;
+	using binary_t = json::binary_t;
+
+	SampleSaxHandler(Sample& sample, ThreadPool& pool, bool keepValues) :
+		domParser(sample.data), sample(sample), pool(pool), keepValues(keepValues) {}
+
+	bool null() { return streaming() ? invalidValue() : forwardDataKey() && domParser.null(); }
+	bool boolean(bool value) { return streaming() ? invalidValue() : forwardDataKey() && domParser.boolean(value); }
+	bool number_integer(number_integer_t value) { return streaming() ? number(value) : forwardDataKey() && domParser.number_integer(value); }
+	bool number_unsigned(number_unsigned_t value) { return streaming() ? number(value) : forwardDataKey() && domParser.number_unsigned(value); }
+	bool number_float(number_float_t value, const string_t& text) {
+		return streaming() ? number(value) : forwardDataKey() && domParser.number_float(value, text);
+	}
+	bool string(string_t& value) { return streaming() ? invalidValue() : forwardDataKey() && domParser.string(value); }
+	bool binary(binary_t& value) { return streaming() ? invalidValue() : forwardDataKey() && domParser.binary(value); }
+
+	bool start_object(std::size_t elements) {
+		depth++;
+		if (streaming()) return invalidValue();
+		if (dataKeyPending && pendingKey == "variationalSeries") return startStreaming(Mode::VariationalSeries);
+		return forwardDataKey() && domParser.start_object(elements);
+	}
+
+	bool end_object() {
+		depth--;
+		if (mode == Mode::VariationalSeries) return stopStreaming();
+		return domParser.end_object();
+	}
+
+	bool start_array(std::size_t elements) {
+		depth++;
+		if (streaming()) return invalidValue();
+		if (dataKeyPending && pendingKey == "values") return startStreaming(Mode::Values);
+		return forwardDataKey() && domParser.start_array(elements);
+	}
+
+	bool end_array() {
+		depth--;
+		if (mode == Mode::Values) return stopStreaming();
+		return domParser.end_array();
+	}
+
+	bool key(string_t& value) {
+		if (mode == Mode::VariationalSeries) {
+			auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), seriesValue);
+			if (error != std::errc() || end != value.data() + value.size()) {
+				throw std::runtime_error(std::format("Variational series value {} is not a number", value));
+			}
+			return true;
+		}
+		if (depth == 1) {
+			pendingKey = value;
+			// The key is held back until its value shows whether the data can be streamed.
+			dataKeyPending = pendingKey == "values" || pendingKey == "variationalSeries";
+			if (dataKeyPending) return true;
+		}
+		return domParser.key(value);
+	}
+
+	bool parse_error(std::size_t position, const std::string& lastToken, const nlohmann::detail::exception& exception) {
+		return domParser.parse_error(position, lastToken, exception);
+	}
+
+private:
+	enum class Mode { None, Values, VariationalSeries };
+
+	bool streaming() const {
+		return mode != Mode::None;
+	}
+
+	// Hands a held back data key to the DOM parser, when its value is not of the streamed shape.
+	bool forwardDataKey() {
+		if (!dataKeyPending) return true;
+		dataKeyPending = false;
+		return domParser.key(pendingKey);
+	}
+
+	bool startStreaming(Mode newMode) {
+		dataKeyPending = false;
+		mode = newMode;
+		sample.hasRawData = true;
+		if (mode == Mode::Values && !keepValues) {
+			sample.moments.emplace();
+			sample.quantiles.emplace();
+		}
+		return true;
+	}
+
+	bool stopStreaming() {
+		if (mode == Mode::Values && keepValues) {
+			sample.values = sample.valuesStorage;
+		} else if (mode == Mode::Values) {
+			flushBlock();
+		} else {
+			sample.variationalSeries = std::move(seriesBuilder).build();
+		}
+		mode = Mode::None;
+		return true;
+	}
+
+	bool number(FloatType value) {
+		if (mode == Mode::Values && keepValues) {
+			sample.valuesStorage.push_back(value);
+		} else if (mode == Mode::Values) {
+			block.push_back(value);
+			if (block.size() == blockSize) flushBlock();
+		} else {
+			seriesBuilder.add(seriesValue, value);
+		}
+		return true;
+	}
+
+	// The values are not kept, so the quantile sketch is built along with the moments.
+	void flushBlock() {
+		auto summary = parallelSampleSummary(pool, block);
+		sample.moments->merge(summary.moments);
+		sample.quantiles->merge(summary.quantiles);
+		block.clear();
+	}
+
+	bool invalidValue() {
+		throw std::runtime_error(std::format("Sample {} must contain only numbers", pendingKey));
+	}
+
+	nlohmann::detail::json_sax_dom_parser<json> domParser;
+	Sample& sample;
+	ThreadPool& pool;
+	bool keepValues;
+	// Values are buffered in bounded blocks, so memory use does not grow with the sample size.
+	static constexpr std::size_t blockSize = 1 << 20;
+	std::vector<FloatType> block;
+	std::size_t depth = 0;
+	std::string pendingKey;
+	bool dataKeyPending = false;
+	Mode mode = Mode::None;
+	FloatType seriesValue = 0;
+	VariationalSeriesBuilder seriesBuilder;
+};
+
+
+// Returns the position of the '[' opening the array stored under the given top-level key.
+std::optional<std::size_t> findTopLevelArray(std::string_view text, std::string_view key) {
+	auto skipWhitespace = [&](std::size_t position) {
+		while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) position++;
+		return position;
+	};
+
+	int depth = 0;
+	for (std::size_t position = 0; position < text.size(); position++) {
+		switch (text[position]) {
+		case '{': case '[':
+			depth++;
+			break;
+		case '}': case ']':
+			depth--;
+			break;
+		case '"': {
+			std::size_t stringBegin = position + 1;
+			for (position = stringBegin; position < text.size() && text[position] != '"'; position++) {
+				if (text[position] == '\\') position++;
+			}
+			if (depth != 1 || text.substr(stringBegin, position - stringBegin) != key) break;
+
+			std::size_t colon = skipWhitespace(position + 1);
+			if (colon >= text.size() || text[colon] != ':') break;
+			std::size_t arrayBegin = skipWhitespace(colon + 1);
+			if (arrayBegin < text.size() && text[arrayBegin] == '[') return arrayBegin;
+			return std::nullopt;
+		}
+		}
+	}
+	return std::nullopt;
+}
+
+bool isJsonWhitespace(char c) {
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+// Returns the end of the JSON number starting at position, or nothing if the text there is not one.
+// from_chars alone also accepts inf, nan and leading zeros.
+const char* jsonNumberEnd(const char* position, const char* end) {
+	auto skipDigits = [&](const char* from) {
+		while (from < end && isDigit(*from)) from++;
+		return from;
+	};
+
+	if (position < end && *position == '-') position++;
+	if (position == end || !isDigit(*position)) return nullptr;
+	position = *position == '0' ? position + 1 : skipDigits(position);
+	if (position < end && *position == '.') {
+		auto fractionEnd = skipDigits(position + 1);
+		if (fractionEnd == position + 1) return nullptr;
+		position = fractionEnd;
+	}
+	if (position < end && (*position == 'e' || *position == 'E')) {
+		position++;
+		if (position < end && (*position == '+' || *position == '-')) position++;
+		auto exponentEnd = skipDigits(position);
+		if (exponentEnd == position) return nullptr;
+		position = exponentEnd;
+	}
+	return position;
+}
+
+// Parses exactly values.size() comma-separated numbers from [position, end). Chunks that are
+// followed by another chunk end right after a separating comma.
+bool parseNumberList(const char* position, const char* end, bool lastChunk, std::span<FloatType> values) {
+	for (auto& value : values) {
+		while (position < end && isJsonWhitespace(*position)) position++;
+		auto numberEnd = jsonNumberEnd(position, end);
+		if (!numberEnd) return false;
+		auto [parsedEnd, error] = std::from_chars(position, numberEnd, value);
+		if (error != std::errc() || parsedEnd != numberEnd) return false;
+
+		position = numberEnd;
+		while (position < end && isJsonWhitespace(*position)) position++;
+		if (position < end && *position == ',') {
+			position++;
+		} else if (position < end || !lastChunk || &value != &values.back()) {
+			return false;
+		}
+	}
+	return position == end && (lastChunk || end[-1] == ',');
+}
+
+// Parses a flat array of numbers starting at arrayBegin; returns the position past its ']',
+// or nothing if the array holds anything else. The array is split at commas into chunks that
+// are counted and parsed in parallel, each straight into its own slice of the output.
+std::optional<std::size_t> parseNumberArray(std::string_view text, std::size_t arrayBegin, std::vector<FloatType>& values, ThreadPool& pool) {
+	std::size_t arrayEnd = text.find(']', arrayBegin);
+	if (arrayEnd == std::string_view::npos) return std::nullopt;
+	const char* end = text.data() + arrayEnd;
+	if (std::all_of(text.data() + arrayBegin + 1, end, isJsonWhitespace)) return arrayEnd + 1;
+
+	constexpr std::size_t chunkBytes = 1 << 20;
+	std::vector<const char*> chunkBounds{ text.data() + arrayBegin + 1 };
+	while (end - chunkBounds.back() > static_cast<std::ptrdiff_t>(chunkBytes)) {
+		auto comma = std::find(chunkBounds.back() + chunkBytes, end, ',');
+		if (comma == end) break;
+		chunkBounds.push_back(comma + 1);
+	}
+	chunkBounds.push_back(end);
+	std::size_t chunkCount = chunkBounds.size() - 1;
+
+	std::vector<std::size_t> chunkOffsets(chunkCount + 1);
+	pool.parallelFor(chunkCount, [&](std::size_t chunk) {
+		chunkOffsets[chunk + 1] = std::count(chunkBounds[chunk], chunkBounds[chunk + 1], ',') + (chunk + 1 == chunkCount);
+	});
+	std::partial_sum(chunkOffsets.begin(), chunkOffsets.end(), chunkOffsets.begin());
+
+	values.resize(chunkOffsets.back());
+	std::atomic<bool> valid = true;
+	pool.parallelFor(chunkCount, [&](std::size_t chunk) {
+		std::span<FloatType> chunkValues(values.data() + chunkOffsets[chunk], chunkOffsets[chunk + 1] - chunkOffsets[chunk]);
+		if (!parseNumberList(chunkBounds[chunk], chunkBounds[chunk + 1], chunk + 1 == chunkCount, chunkValues)) valid = false;
+	});
+	if (!valid) return std::nullopt;
+	return arrayEnd + 1;
+}
+
+// Reads the usual sample shape, a flat "values" array of numbers, with a dedicated scanner
+// and hands only the rest of the document to nlohmann; anything else goes through the SAX handler.
+Sample loadJsonSample(const std::filesystem::path& path, ThreadPool& pool, bool keepValues) {
+	MappedFile mapping(path);
+	std::string_view text(reinterpret_cast<const char*>(mapping.bytes().data()), mapping.bytes().size());
+
+	Sample sample;
+	if (auto arrayBegin = findTopLevelArray(text, "values")) {
+		if (auto arrayEnd = parseNumberArray(text, *arrayBegin, sample.valuesStorage, pool)) {
+			sample.data = json::parse(std::string(text.substr(0, *arrayBegin)) + "[]" + std::string(text.substr(*arrayEnd)));
+			sample.data.erase("values");
+			sample.values = sample.valuesStorage;
+			sample.hasRawData = true;
+			return sample;
+		}
+		sample.valuesStorage = {};
+	}
+
+	SampleSaxHandler handler(sample, pool, keepValues);
+	json::sax_parse(text.begin(), text.end(), &handler);
+	return sample;
+}
+
+FloatType totalAmount(std::span<const std::pair<FloatType, FloatType>> series) {
+	FloatType total = 0;
+	for (const auto& [value, amount] : series) total += amount;
+	return total;
+}
+
+// The moments stored in a description. States stored without the higher moments are not used.
+std::optional<MomentAccumulator<FloatType, true>> describedMoments(const json& description) {
+	if (!description.contains("statistics") || !description["statistics"].contains("moments")) return std::nullopt;
+	const auto& state = description["statistics"]["moments"];
+	if (!state.contains("m3") || !state.contains("m4")) return std::nullopt;
+	return state.get<MomentAccumulator<FloatType, true>>();
+}
+
+// Moments stored in the description, if they were accumulated over as many values as the sample has.
+// Only binary samples use them: their descriptions are written together with the data, while the
+// values of a JSON sample are parsed anyway and may have been edited since the moments were stored.
+std::optional<MomentAccumulator<FloatType, true>> storedMoments(const Sample& sample) {
+	if (!sample.hasRawData) return std::nullopt;
+	auto moments = describedMoments(sample.data);
+	if (!moments) return std::nullopt;
+	FloatType count = sample.variationalSeries.empty() ? static_cast<FloatType>(sample.values.size()) : totalAmount(sample.variationalSeries);
+	if (moments->count != count) return std::nullopt;
+	return moments;
+}
+
+Sample loadSample(const std::filesystem::path& path, ThreadPool& pool, bool keepValues) {
+	if (!isBinarySample(path)) return loadJsonSample(path, pool, keepValues);
+	auto sample = loadBinarySample(path);
+	sample.moments = storedMoments(sample);
+	return sample;
+}
+
+
+MomentAccumulator<FloatType, true> rawDataMoments(const Sample& sample, ThreadPool& pool) {
+	if (sample.moments) return *sample.moments;
+	if (!sample.variationalSeries.empty()) return variationalSeriesMoments(sample.variationalSeries, pool);
+	return parallelSampleMoments<FloatType, true>(pool, sample.values);
+}
+
+// Appends in place after the data of a binary sample whose stored moments cover it, if the updated
+// description fits into the space reserved for it.
+bool appendToBinarySample(const std::filesystem::path& path, const Sample& appended, const MomentAccumulator<FloatType, true>& appendedMoments) {
+	std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+	BinarySampleHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	std::string descriptionText(header.descriptionSize, '\0');
+	file.read(descriptionText.data(), descriptionText.size());
+	if (!file || header.layout == BinarySampleLayout::None) return false;
+
+	json description = json::parse(descriptionText);
+	auto storedMoments = describedMoments(description);
+	if (!storedMoments) return false;
+	auto moments = *storedMoments;
+
+	std::vector<FloatType> data;
+	if (header.layout == BinarySampleLayout::Values) {
+		if (!appended.variationalSeries.empty() || moments.count != static_cast<FloatType>(header.elementCount)) return false;
+		data.assign(appended.values.begin(), appended.values.end());
+	} else {
+		std::vector<std::pair<FloatType, FloatType>> series(header.elementCount);
+		file.seekg(header.dataOffset);
+		file.read(reinterpret_cast<char*>(series.data()), series.size() * sizeof(series[0]));
+		if (!file || moments.count != totalAmount(series)) return false;
+		if (appended.variationalSeries.empty()) {
+			for (FloatType value : appended.values) data.insert(data.end(), { value, 1 });
+		} else {
+			for (const auto& [value, amount] : appended.variationalSeries) data.insert(data.end(), { value, amount });
+		}
+	}
+
+	moments.merge(appendedMoments);
+	description["statistics"]["moments"] = moments;
+	descriptionText = description.dump();
+	if (sizeof(header) + descriptionText.size() > header.dataOffset) return false;
+
+	std::uint64_t stride = header.layout == BinarySampleLayout::VariationalSeries ? 2 : 1;
+	file.seekp(header.dataOffset + header.elementCount * stride * sizeof(FloatType));
+	file.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(FloatType));
+	header.elementCount += data.size() / stride;
+	header.descriptionSize = descriptionText.size();
+	descriptionText.resize(header.dataOffset - sizeof(header), '\0');
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(descriptionText.data(), descriptionText.size());
+	if (!file) throw std::runtime_error(std::format("Cannot write {}", path.string()));
+	return true;
+}
+
+void appendToSample(const std::filesystem::path& path, const Sample& appended, ThreadPool& pool) {
+	if (!appended.hasRawData || (appended.values.empty() && appended.variationalSeries.empty())) {
+		throw std::runtime_error("The appended sample has no data");
+	}
+	auto appendedMoments = rawDataMoments(appended, pool);
+	if (isBinarySample(path) && appendToBinarySample(path, appended, appendedMoments)) return;
+
+	auto sample = loadSample(path, pool, true);
+	if (!sample.hasRawData) throw std::runtime_error(std::format("{} has no data to append to", path.string()));
+	auto moments = rawDataMoments(sample, pool);
+	moments.merge(appendedMoments);
+	sample.data["statistics"]["moments"] = moments;
+
+	// The sample may be mapped from the file, so it is written next to it and then moved over it.
+	// The temporary name keeps the extension, which selects the format the sample is written in.
+	auto temporaryPath = path.parent_path() / (path.stem().string() + ".tmp" + path.extension().string());
+	if (sample.variationalSeries.empty()) {
+		if (!appended.variationalSeries.empty()) throw std::runtime_error("Cannot append a variational series to a sample of values");
+		std::uint64_t oldSize = sample.values.size();
+		saveSample(temporaryPath, sample.data, oldSize + appended.values.size(), [&](std::uint64_t first, std::span<FloatType> block) {
+			for (std::size_t i = 0; i < block.size(); i++) {
+				block[i] = first + i < oldSize ? sample.values[first + i] : appended.values[first + i - oldSize];
+			}
+		}, pool);
+	} else {
+		VariationalSeriesBuilder seriesBuilder;
+		for (const auto& [value, amount] : sample.variationalSeries) seriesBuilder.add(value, amount);
+		for (const auto& [value, amount] : appended.variationalSeries) seriesBuilder.add(value, amount);
+		// Appended values enter the series as runs of equal values.
+		std::vector<FloatType> appendedValues(appended.values.begin(), appended.values.end());
+		RadixSorter().sort(appendedValues, pool);
+		for (const auto& [value, amount] : runLengthEncode(appendedValues)) seriesBuilder.add(value, amount);
+		saveSample(temporaryPath, sample.data, std::move(seriesBuilder).build());
+	}
+	sample = {};
+	std::filesystem::rename(temporaryPath, path);
+}
+
+
+// Quantile statistics and their probabilities in percent.
+const std::vector<std::pair<std::string, int>> quantileStatistics{
+	{ "percentile1", 1 },
+	{ "percentile5", 5 },
+	{ "lowerQuartile", 25 },
+	{ "median", 50 },
+	{ "upperQuartile", 75 },
+	{ "percentile95", 95 },
+	{ "percentile99", 99 },
+};
+
+// Larger samples of values get their quantiles from a sketch.
+constexpr std::size_t exactQuantilesLimit = 1 << 24;
+
+bool isQuantileStatistic(const std::string& name) {
+	return name == "interquartileRange"
+		|| std::ranges::find(quantileStatistics, name, &std::pair<std::string, int>::first) != quantileStatistics.end();
+}
+
+
+// Evaluates statistics on demand. Each rule reads the statistics it depends on through evaluate, so only
+// the requested statistics and their dependencies are computed, each at most once. Samples without raw
+// data fall back to the statistics given in their description.
+class StatisticsEvaluator {
+public:
+	StatisticsEvaluator(Sample& sample, ThreadPool& pool, bool needsVariance, bool needsQuantiles) :
+		sample(sample), pool(pool), needsVariance(needsVariance), needsQuantiles(needsQuantiles) {}
+
+	std::optional<FloatType> evaluate(const std::string& name) {
+		if (auto found = evaluated.find(name); found != evaluated.end()) return found->second;
+		auto rule = rules.find(name);
+		if (rule == rules.end()) throw std::runtime_error(std::format("Unknown statistic {}", name));
+
+		auto value = (this->*rule->second)();
+		evaluated.emplace(name, value);
+		if (value) (name == "sampleSize" ? sample.data["params"] : sample.data["statistics"])[name] = *value;
+		return value;
+	}
+
+	static std::vector<std::string> names() {
+		std::vector<std::string> ruleNames;
+		for (const auto& [name, rule] : rules) ruleNames.push_back(name);
+		return ruleNames;
+	}
+
+private:
+	using Rule = std::optional<FloatType>(StatisticsEvaluator::*)();
+
+	std::optional<FloatType> sampleSize() {
+		if (!sample.hasRawData) return described("params", "sampleSize");
+		if (!sample.moments && sample.variationalSeries.empty()) return static_cast<FloatType>(sample.values.size());
+		return moments().count;
+	}
+
+	// The mean alone needs a cheaper pass; when a variance is needed too, both come from one moments pass.
+	std::optional<FloatType> mean() {
+		if (!sample.hasRawData) return described("statistics", "mean");
+		if (!sample.moments && sample.variationalSeries.empty() && !needsVariance) return parallelSampleMean<FloatType>(pool, sample.values);
+		return moments().mean;
+	}
+
+	std::optional<FloatType> biasedVariance() {
+		if (sample.hasRawData) return moments().biasedVariance();
+		if (auto variance = described("statistics", "biasedVariance")) return variance;
+		auto variance = described("statistics", "unbiasedVariance");
+		auto size = evaluate("sampleSize");
+		if (!variance || !size) return std::nullopt;
+		return *variance * (*size - 1) / *size;
+	}
+
+	std::optional<FloatType> unbiasedVariance() {
+		if (!sample.hasRawData && !described("statistics", "biasedVariance")) return described("statistics", "unbiasedVariance");
+		auto variance = evaluate("biasedVariance");
+		auto size = evaluate("sampleSize");
+		if (!variance || !size) return std::nullopt;
+		return *variance * *size / (*size - 1);
+	}
+
+	std::optional<FloatType> biasedStandardDeviation() {
+		auto variance = evaluate("biasedVariance");
+		if (!variance) return std::nullopt;
+		return std::sqrt(*variance);
+	}
+
+	std::optional<FloatType> unbiasedStandardDeviation() {
+		auto variance = evaluate("unbiasedVariance");
+		if (!variance) return std::nullopt;
+		return std::sqrt(*variance);
+	}
+
+	std::optional<FloatType> minimum() {
+		if (!sample.hasRawData) return described("statistics", "minimum");
+		return moments().min;
+	}
+
+	std::optional<FloatType> maximum() {
+		if (!sample.hasRawData) return described("statistics", "maximum");
+		return moments().max;
+	}
+
+	std::optional<FloatType> skewness() {
+		if (!sample.hasRawData) return described("statistics", "skewness");
+		const auto& sampleMoments = moments();
+		return std::sqrt(sampleMoments.count) * sampleMoments.m3 / std::pow(sampleMoments.m2, 1.5);
+	}
+
+	std::optional<FloatType> excessKurtosis() {
+		if (!sample.hasRawData) return described("statistics", "excessKurtosis");
+		const auto& sampleMoments = moments();
+		return sampleMoments.count * sampleMoments.m4 / (sampleMoments.m2 * sampleMoments.m2) - 3;
+	}
+
+	template<int Percent>
+	std::optional<FloatType> percentile() {
+		if (!sample.hasRawData) {
+			return described("statistics", std::ranges::find(quantileStatistics, Percent, &std::pair<std::string, int>::second)->first);
+		}
+		if (hasExactQuantiles()) {
+			return selectedQuantiles()[std::ranges::find(quantileStatistics, Percent, &std::pair<std::string, int>::second) - quantileStatistics.begin()];
+		}
+		auto& sketch = quantiles();
+		if (sketch.totalWeight() == 0) return std::nullopt;
+		return sketch.quantile(Percent / FloatType(100));
+	}
+
+	// Series with fractional amounts have no ranks and get their quantiles from a sketch.
+	bool hasExactQuantiles() {
+		if (!sample.variationalSeries.empty()) {
+			if (!integerSeries) integerSeries = hasIntegerAmounts(sample.variationalSeries);
+			return *integerSeries;
+		}
+		return !sample.values.empty() && sample.values.size() <= exactQuantilesLimit;
+	}
+
+	// Every quantile statistic at once, as a single selection finds them all.
+	const std::vector<FloatType>& selectedQuantiles() {
+		if (!exactQuantileValues) {
+			std::vector<FloatType> probabilities;
+			for (const auto& [name, percent] : quantileStatistics) probabilities.push_back(percent / FloatType(100));
+			exactQuantileValues = sample.variationalSeries.empty()
+				? exactQuantiles(sample.values, probabilities, pool)
+				: exactQuantiles(sample.variationalSeries, probabilities);
+		}
+		return *exactQuantileValues;
+	}
+
+	std::optional<FloatType> interquartileRange() {
+		if (!sample.hasRawData) return described("statistics", "interquartileRange");
+		auto lower = evaluate("lowerQuartile");
+		auto upper = evaluate("upperQuartile");
+		if (!lower || !upper) return std::nullopt;
+		return *upper - *lower;
+	}
+
+	std::optional<FloatType> described(const std::string& section, const std::string& name) const {
+		if (!sample.data.contains(section) || !sample.data[section].contains(name)) return std::nullopt;
+		return sample.data[section][name].get<FloatType>();
+	}
+
+	const MomentAccumulator<FloatType, true>& moments() {
+		if (!sample.moments) {
+			if (!sample.variationalSeries.empty()) sample.moments = variationalSeriesMoments(sample.variationalSeries, pool);
+			else if (needsQuantiles && !hasExactQuantiles() && !sample.quantiles) summarizeValues();
+			else sample.moments = parallelSampleMoments<FloatType, true>(pool, sample.values);
+		}
+		return *sample.moments;
+	}
+
+	QuantileSketch& quantiles() {
+		if (!sample.quantiles) {
+			if (!sample.variationalSeries.empty()) sample.quantiles = variationalSeriesSketch(sample.variationalSeries);
+			else if (!sample.moments) summarizeValues();
+			else sample.quantiles = parallelQuantileSketch(pool, sample.values);
+		}
+		return *sample.quantiles;
+	}
+
+	// The moments and the quantile sketch of the values from a single pass.
+	void summarizeValues() {
+		auto summary = parallelSampleSummary(pool, sample.values);
+		sample.moments = summary.moments;
+		sample.quantiles = std::move(summary.quantiles);
+	}
+
+	static inline const std::map<std::string, Rule> rules{
+		{ "sampleSize", &StatisticsEvaluator::sampleSize },
+		{ "mean", &StatisticsEvaluator::mean },
+		{ "biasedVariance", &StatisticsEvaluator::biasedVariance },
+		{ "unbiasedVariance", &StatisticsEvaluator::unbiasedVariance },
+		{ "biasedStandardDeviation", &StatisticsEvaluator::biasedStandardDeviation },
+		{ "unbiasedStandardDeviation", &StatisticsEvaluator::unbiasedStandardDeviation },
+		{ "minimum", &StatisticsEvaluator::minimum },
+		{ "maximum", &StatisticsEvaluator::maximum },
+		{ "skewness", &StatisticsEvaluator::skewness },
+		{ "excessKurtosis", &StatisticsEvaluator::excessKurtosis },
+		{ "percentile1", &StatisticsEvaluator::percentile<1> },
+		{ "percentile5", &StatisticsEvaluator::percentile<5> },
+		{ "lowerQuartile", &StatisticsEvaluator::percentile<25> },
+		{ "median", &StatisticsEvaluator::percentile<50> },
+		{ "upperQuartile", &StatisticsEvaluator::percentile<75> },
+		{ "percentile95", &StatisticsEvaluator::percentile<95> },
+		{ "percentile99", &StatisticsEvaluator::percentile<99> },
+		{ "interquartileRange", &StatisticsEvaluator::interquartileRange },
+	};
+
+	Sample& sample;
+	ThreadPool& pool;
+	bool needsVariance;
+	bool needsQuantiles;
+	std::map<std::string, std::optional<FloatType>> evaluated;
+	std::optional<std::vector<FloatType>> exactQuantileValues;
+	std::optional<bool> integerSeries;
+};
+
+
+void calculateStatistics(Sample& loadedSample, std::span<const std::string> statistics, ThreadPool& pool) {
+	bool needsVariance = std::ranges::any_of(statistics, [](const std::string& name) { return name != "sampleSize" && name != "mean"; });
+	bool needsQuantiles = std::ranges::any_of(statistics, isQuantileStatistic);
+	StatisticsEvaluator evaluator(loadedSample, pool, needsVariance, needsQuantiles);
+	for (const auto& name : statistics) evaluator.evaluate(name);
+}
+
+void calculateStatistics(Sample& loadedSample, ThreadPool& pool) {
+	calculateStatistics(loadedSample, StatisticsEvaluator::names(), pool);
+}
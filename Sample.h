@@ -0,0 +1,123 @@
+﻿#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <probstats/probstats.h>
+
+
+using nlohmann::json;
+
+
+// Moment accumulator states are stored in the "moments" member of a sample's "statistics" section,
+// so that statistics of a sample that grows by appending can be updated from the appended data alone.
+template<std::floating_point T, bool HigherMoments>
+struct nlohmann::adl_serializer<probstats::MomentAccumulator<T, HigherMoments>> {
+	static void to_json(json& state, const probstats::MomentAccumulator<T, HigherMoments>& moments) {
+		state = { { "count", moments.count }, { "mean", moments.mean }, { "m2", moments.m2 } };
+		if constexpr (HigherMoments) {
+			state["m3"] = moments.m3;
+			state["m4"] = moments.m4;
+		}
+		if (moments.count != 0) {
+			state["min"] = moments.min;
+			state["max"] = moments.max;
+		}
+	}
+
+	static void from_json(const json& state, probstats::MomentAccumulator<T, HigherMoments>& moments) {
+		moments = {};
+		moments.count = state.at("count").get<T>();
+		moments.mean = state.at("mean").get<T>();
+		moments.m2 = state.at("m2").get<T>();
+		if constexpr (HigherMoments) {
+			moments.m3 = state.at("m3").get<T>();
+			moments.m4 = state.at("m4").get<T>();
+		}
+		if (moments.count != 0) {
+			moments.min = state.at("min").get<T>();
+			moments.max = state.at("max").get<T>();
+		}
+	}
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::filesystem::path& path);
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	~MappedFile();
+
+	std::span<const std::byte> bytes() const {
+		return { data, size };
+	}
+
+private:
+	void swap(MappedFile& other) noexcept;
+
+	const std::byte* data = nullptr;
+	std::size_t size = 0;
+	// Win32 file and mapping handles.
+	void* file = nullptr;
+	void* mapping = nullptr;
+};
+
+
+struct Sample {
+	json data;
+	// Whether the sample has raw data, as opposed to only the statistics given in its description.
+	bool hasRawData = false;
+	// Moments of the raw data, accumulated while streaming or on first use.
+	std::optional<probstats::MomentAccumulator<probstats::FloatType, true>> moments;
+	// Quantile sketch of the raw data, built in the same pass as the moments when both are needed.
+	std::optional<probstats::QuantileSketch> quantiles;
+	// Raw values, either read in place from a mapped binary sample or parsed into valuesStorage.
+	MappedFile mapping;
+	std::vector<probstats::FloatType> valuesStorage;
+	std::span<const probstats::FloatType> values;
+	// Variational series decoded once into (value, amount) buckets sorted by value.
+	std::vector<std::pair<probstats::FloatType, probstats::FloatType>> variationalSeries;
+};
+
+
+// Moments stored in the description are used instead of a pass over the data when they cover all of it.
+// JSON values that the fast scanner rejects are streamed into moments and a quantile sketch without
+// being kept, unless keepValues is set.
+Sample loadSample(const std::filesystem::path& path, probstats::ThreadPool& pool, bool keepValues = false);
+
+// The binary sample stores the moments of its data in its description.
+void convertToBinarySample(const std::filesystem::path& input, const std::filesystem::path& output, probstats::ThreadPool& pool);
+
+// Writes a sample with the given description and valuesCount values, as JSON or, for a .bsample path,
+// in the binary layout. The values are produced block by block by fill(first, block), so that
+// samples larger than memory can be written.
+void saveSample(const std::filesystem::path& path, const json& description, std::uint64_t valuesCount,
+	const std::function<void(std::uint64_t, std::span<probstats::FloatType>)>& fill, probstats::ThreadPool& pool);
+
+// Writes a sample given as a variational series of (value, amount) pairs.
+void saveSample(const std::filesystem::path& path, const json& description,
+	std::span<const std::pair<probstats::FloatType, probstats::FloatType>> variationalSeries);
+
+// Appends the raw data of another sample to a sample file and updates its stored moments by merging
+// them with the moments of the appended data. Binary samples with stored moments are updated in place,
+// at a cost proportional to the appended data only; other samples are rewritten.
+void appendToSample(const std::filesystem::path& path, const Sample& appended, probstats::ThreadPool& pool);
+
+// Evaluates the named statistics ("sampleSize" or a key of the "statistics" section) and what they
+// depend on, storing them in the sample description. Statistics that are not requested are not computed.
+void calculateStatistics(Sample& loadedSample, std::span<const std::string> statistics, probstats::ThreadPool& pool);
+
+// Whether the statistic is a quantile. Quantiles of variational series and of samples of up to 2^24 values
+// are exact, found by selection; those of larger or streamed samples are estimated from a quantile sketch.
+bool isQuantileStatistic(const std::string& name);
+
+// Evaluates every statistic.
+void calculateStatistics(Sample& loadedSample, probstats::ThreadPool& pool);
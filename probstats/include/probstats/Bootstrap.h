@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <span>
+#include <utility>
+
+#include "MomentAccumulator.h"
+#include "ThreadPool.h"
+#include "ConfidenceIntervals.h"
+
+
+namespace probstats {
+
+struct BootstrapIntervals {
+	ConfidenceInterval percentile;
+	ConfidenceInterval basic;
+	// Bias-corrected and accelerated, with the acceleration estimated by the jackknife.
+	ConfidenceInterval bca;
+};
+
+struct BootstrapReport {
+	BootstrapIntervals mean;
+	BootstrapIntervals unbiasedVariance;
+	BootstrapIntervals unbiasedStandardDeviation;
+};
+
+
+// Bootstrap confidence intervals from the given number of resamples of the values. Resample r is drawn
+// from the Philox stream 2^63 + r of the seed, so the result does not depend on the number of threads,
+// and a resample of a generated sample does not reuse the stream the sample was drawn from.
+// The jackknife of the BCa intervals is evaluated in closed form from the shifted sums of the sample.
+// Throws std::invalid_argument for samples of fewer than three values.
+BootstrapReport bootstrapConfidenceIntervals(std::span<const FloatType> values, FloatType confidence,
+	std::size_t replicates, std::uint64_t seed, ThreadPool& pool);
+
+// The series holds (value, amount) pairs. Each resample draws the bucket amounts from the multinomial
+// distribution with the bucket frequencies as probabilities, as a chain of binomial draws over the
+// buckets, so its cost does not depend on the total amount.
+BootstrapReport bootstrapConfidenceIntervals(std::span<const std::pair<FloatType, FloatType>> series, FloatType confidence,
+	std::size_t replicates, std::uint64_t seed, ThreadPool& pool);
+
+}
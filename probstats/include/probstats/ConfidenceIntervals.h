@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <span>
+
+#include "MomentAccumulator.h"
+#include "Quantiles.h"
+
+
+namespace probstats {
+
+struct ConfidenceInterval {
+	FloatType lower = 0;
+	FloatType upper = 0;
+};
+
+
+ConfidenceInterval meanConfidenceIntervalWithKnownVariance(
+	FloatType sampleSize, FloatType statMean, FloatType variance, FloatType confidence,
+	QuantileMethod method = QuantileMethod::Exact
+);
+
+ConfidenceInterval meanConfidenceIntervalWithUnknownVariance(
+	FloatType sampleSize, FloatType statMean, FloatType statUnbiasedVariance, FloatType confidence,
+	QuantileMethod method = QuantileMethod::Exact
+);
+
+
+ConfidenceInterval varianceConfidenceInterval(
+	FloatType sampleSize, FloatType statUnbiasedVariance, FloatType confidence,
+	QuantileMethod method = QuantileMethod::Exact
+);
+
+
+// Batch variants over structure-of-arrays inputs: entry i of every input span describes one sample,
+// and its interval is written to lowers[i] and uppers[i]. All spans must have the same length.
+// Quantiles are looked up once per distinct (degrees of freedom, confidence) pair in the batch.
+void meanConfidenceIntervalsWithKnownVariance(
+	std::span<const FloatType> sampleSizes, std::span<const FloatType> statMeans, std::span<const FloatType> variances,
+	std::span<const FloatType> confidences, std::span<FloatType> lowers, std::span<FloatType> uppers,
+	QuantileMethod method = QuantileMethod::Exact
+);
+
+void meanConfidenceIntervalsWithUnknownVariance(
+	std::span<const FloatType> sampleSizes, std::span<const FloatType> statMeans, std::span<const FloatType> statUnbiasedVariances,
+	std::span<const FloatType> confidences, std::span<FloatType> lowers, std::span<FloatType> uppers,
+	QuantileMethod method = QuantileMethod::Exact
+);
+
+void varianceConfidenceIntervals(
+	std::span<const FloatType> sampleSizes, std::span<const FloatType> statUnbiasedVariances,
+	std::span<const FloatType> confidences, std::span<FloatType> lowers, std::span<FloatType> uppers,
+	QuantileMethod method = QuantileMethod::Exact
+);
+
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include <cstdint>
+
+#include "MomentAccumulator.h"
+#include "ThreadPool.h"
+#include "Quantiles.h"
+#include "Generators.h"
+
+
+namespace probstats {
+
+struct CoverageEstimate {
+	// Fraction of the replicates whose interval contains the true parameter.
+	FloatType coverage = 0;
+	// Binomial standard error of the coverage, sqrt(coverage * (1 - coverage) / replicates).
+	FloatType standardError = 0;
+};
+
+struct CoverageReport {
+	CoverageEstimate meanWithKnownVariance;
+	CoverageEstimate meanWithUnknownVariance;
+	CoverageEstimate variance;
+};
+
+
+// Monte Carlo check of the confidence intervals against the generator's true mean and variance.
+// Replicate r is the elements [r * sampleSize, (r + 1) * sampleSize) of the generator's stream, so the
+// result does not depend on the number of threads. Replicates are processed in blocks that reuse
+// per-thread buffers, with the intervals of a block computed by the batch interval functions.
+CoverageReport simulateCoverage(const SampleGenerator& generator, std::uint64_t sampleSize, std::uint64_t replicates,
+	FloatType confidence, ThreadPool& pool, QuantileMethod method = QuantileMethod::Exact);
+
+}
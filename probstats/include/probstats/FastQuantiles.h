@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "MomentAccumulator.h"
+
+
+namespace probstats {
+
+// Closed-form quantile approximations, much cheaper than Boost's generic root finding for large
+// degrees of freedom. The maximum relative errors below were measured against Boost.Math for
+// probabilities in [3e-7, 1 - 3e-7] and degrees of freedom from 1 to 1e9. Probabilities 0 and 1 give
+// the ends of the support (infinite, or 0 for chi-squared), and probabilities outside [0, 1] give NaN.
+
+// Below these degrees of freedom the approximations are refined on the exact distribution functions
+// and cost about as much as Boost's quantiles, so QuantileMethod::Fast uses the cached exact path there.
+constexpr FloatType studentsTRefinementLimit = 100;
+constexpr FloatType chiSquaredRefinementLimit = 1e4;
+
+// Wichura's algorithm AS241 (PPND16). Relative error below 5e-16.
+FloatType fastNormalQuantile(FloatType probability);
+
+// Exact closed forms for 1 and 2 degrees of freedom, a central series for |p - 1/2| < 0.01 and Hill's
+// algorithm 396 otherwise. For fewer than 100 degrees of freedom, where the expansion is least accurate,
+// the result is polished with Newton steps on the exact distribution function.
+// Relative error below 5e-16 for 1 and 2 degrees of freedom, below 2e-15 for fewer than 100 and below
+// 3e-11 otherwise, measured against 50-digit Boost.Math: its double precision quantiles are themselves
+// inaccurate within about 1e-9 of the median.
+FloatType fastStudentsTQuantile(FloatType degreesOfFreedom, FloatType probability);
+
+// Wilson-Hilferty or Cornish-Fisher starting points refined by Newton steps on the incomplete gamma
+// function; from 1e4 degrees of freedom the Cornish-Fisher expansion is used on its own.
+// Relative error below 5e-15 for fewer than 1e4 degrees of freedom and below 1.1e-12 otherwise.
+FloatType fastChiSquaredQuantile(FloatType degreesOfFreedom, FloatType probability);
+
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "MomentAccumulator.h"
+#include "ThreadPool.h"
+#include "Philox.h"
+#include "QuantileSketch.h"
+
+
+namespace probstats {
+
+struct NormalDistribution {
+	FloatType mean = 0;
+	FloatType standardDeviation = 1;
+};
+
+struct ExponentialDistribution {
+	FloatType rate = 1;
+};
+
+struct PoissonDistribution {
+	FloatType mean = 1;
+};
+
+// Number of successes in draws without replacement from a population containing the given number of successes.
+struct HypergeometricDistribution {
+	std::uint64_t population = 1;
+	std::uint64_t successes = 0;
+	std::uint64_t draws = 0;
+};
+
+using SampleDistribution = std::variant<NormalDistribution, ExponentialDistribution, PoissonDistribution, HypergeometricDistribution>;
+
+
+// Draws samples by inversion of the distribution function. Element i of a sample is computed from
+// the Philox block with counter i alone, so the sample only depends on the seed and the stream,
+// never on how its elements are split between threads. Discrete distributions are inverted with
+// a table of the distribution function over the values whose probabilities are not negligible.
+class SampleGenerator {
+public:
+	// Throws std::invalid_argument for invalid parameters.
+	SampleGenerator(const SampleDistribution& distribution, std::uint64_t seed, std::uint64_t stream = 0);
+
+	FloatType operator()(std::uint64_t index) const;
+
+	// Fills values with the elements [first, first + values.size()) of the sample.
+	void generate(std::uint64_t first, std::span<FloatType> values) const;
+
+	bool isDiscrete() const {
+		return !cumulativeProbabilities.empty();
+	}
+
+	// The values a discrete distribution is drawn from: supportSize() consecutive integers from supportMin().
+	FloatType supportMin() const {
+		return firstValue;
+	}
+
+	std::size_t supportSize() const {
+		return cumulativeProbabilities.size();
+	}
+
+	FloatType mean() const;
+	FloatType variance() const;
+
+private:
+	SampleDistribution distribution;
+	Philox4x32 generator;
+	FloatType firstValue = 0;
+	std::vector<FloatType> cumulativeProbabilities;
+};
+
+
+// Fills values with the elements [first, first + values.size()) of the sample on the pool.
+void generateSample(const SampleGenerator& generator, std::uint64_t first, std::span<FloatType> values, ThreadPool& pool);
+
+// Moments of a sample of the given size, accumulated in fixed-size chunks without storing the sample.
+MomentAccumulator<FloatType, true> generatedSampleMoments(const SampleGenerator& generator, std::uint64_t size, ThreadPool& pool);
+
+// The moments and a quantile sketch from the same chunks.
+SampleSummary generatedSampleSummary(const SampleGenerator& generator, std::uint64_t size, ThreadPool& pool,
+	FloatType compression = QuantileSketch::defaultCompression);
+
+// Variational series of a sample of a discrete distribution, as (value, amount) pairs sorted by value.
+std::vector<std::pair<FloatType, FloatType>> generateVariationalSeries(const SampleGenerator& generator, std::uint64_t size, ThreadPool& pool);
+
+}
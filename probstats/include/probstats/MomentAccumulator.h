@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <concepts>
+#include <limits>
+#include <algorithm>
+
+
+namespace probstats {
+
+// Floating-point type of the non-template API.
+using FloatType = double;
+
+
+// Weighted Welford accumulator; partial states are combined with Chan's (Pebay's for M3/M4) merge formulas.
+// The state is the whole summary of the data, so a sample that grows can be summarised by merging
+// the state of its old data with that of the new data instead of a pass over all of it.
+template<std::floating_point T, bool HigherMoments = false>
+struct MomentAccumulator {
+	T count = 0, mean = 0, m2 = 0, m3 = 0, m4 = 0;
+	T min = std::numeric_limits<T>::infinity(), max = -std::numeric_limits<T>::infinity();
+
+	void push(T value) {
+		pushWeighted(value, 1);
+	}
+
+	void pushWeighted(T value, T amount) {
+		if (amount == 0) return;
+		min = std::min(min, value);
+		max = std::max(max, value);
+		T previousCount = count;
+		count += amount;
+		T delta = value - mean;
+		T deltaN = delta / count;
+		T term = delta * deltaN * previousCount * amount;
+		mean += amount * delta / count;
+		if constexpr (HigherMoments) {
+			m4 += term * deltaN * deltaN * (previousCount * previousCount - previousCount * amount + amount * amount)
+				+ 6 * deltaN * deltaN * amount * amount * m2 - 4 * deltaN * amount * m3;
+			m3 += term * deltaN * (previousCount - amount) - 3 * deltaN * amount * m2;
+		}
+		m2 += term;
+	}
+
+	void merge(const MomentAccumulator& other) {
+		if (other.count == 0) return;
+		if (count == 0) {
+			*this = other;
+			return;
+		}
+		min = std::min(min, other.min);
+		max = std::max(max, other.max);
+		T previousCount = count;
+		count += other.count;
+		T delta = other.mean - mean;
+		T deltaN = delta / count;
+		T term = delta * deltaN * previousCount * other.count;
+		mean += other.count * deltaN;
+		if constexpr (HigherMoments) {
+			m4 += other.m4
+				+ term * deltaN * deltaN * (previousCount * previousCount - previousCount * other.count + other.count * other.count)
+				+ 6 * deltaN * deltaN * (previousCount * previousCount * other.m2 + other.count * other.count * m2)
+				+ 4 * deltaN * (previousCount * other.m3 - other.count * m3);
+			m3 += other.m3 + term * deltaN * (previousCount - other.count) + 3 * deltaN * (previousCount * other.m2 - other.count * m2);
+		}
+		m2 += other.m2 + term;
+	}
+
+	T biasedVariance() const {
+		return m2 / count;
+	}
+};
+
+
+}
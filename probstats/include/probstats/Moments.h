@@ -0,0 +1,186 @@
+﻿#pragma once
+
+#include <ranges>
+#include <optional>
+#include <vector>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#ifndef __SIZEOF_INT128__
+#include <boost/multiprecision/cpp_int.hpp>
+#endif
+
+#include "MomentAccumulator.h"
+#include "ThreadPool.h"
+
+
+namespace probstats {
+
+template<class T>
+concept SimdFloat = std::same_as<T, float> || std::same_as<T, double>;
+
+// Moments of a contiguous array, computed by the widest SIMD kernel the CPU supports.
+// Instantiated for float and double, with and without the higher moments.
+template<SimdFloat T, bool HigherMoments = false>
+MomentAccumulator<T, HigherMoments> contiguousSampleMoments(const T* values, std::size_t size);
+
+
+// Samples are either ranges of (value, amount) pairs or ranges of plain values with amount 1.
+template<class Range, class T>
+concept VarSeriesRange = std::ranges::sized_range<Range> && std::is_convertible_v<std::ranges::range_value_t<Range>, std::pair<T, T>>;
+
+template<class Range, class T>
+concept ValuesRange = std::ranges::sized_range<Range> && std::is_convertible_v<std::ranges::range_value_t<Range>, T>;
+
+
+template<std::floating_point T, bool HigherMoments = false, std::ranges::sized_range Range>
+	requires VarSeriesRange<Range, T> || ValuesRange<Range, T>
+MomentAccumulator<T, HigherMoments> sampleMoments(Range&& values) {
+	MomentAccumulator<T, HigherMoments> moments;
+	if constexpr (SimdFloat<T> && std::ranges::contiguous_range<Range> && std::same_as<std::ranges::range_value_t<Range>, T>) {
+		moments = contiguousSampleMoments<T, HigherMoments>(std::ranges::data(values), std::ranges::size(values));
+	} else if constexpr (ValuesRange<Range, T>) {
+		for (T value : values) moments.push(value);
+	} else {
+		for (const auto& [value, amount] : values) moments.pushWeighted(value, amount);
+	}
+	return moments;
+}
+
+
+template<std::floating_point T, std::ranges::sized_range Range>
+	requires VarSeriesRange<Range, T> || ValuesRange<Range, T>
+T sampleSize(Range&& values) {
+	return sampleMoments<T>(values).count;
+}
+
+
+template<std::floating_point T, std::ranges::sized_range Range>
+	requires VarSeriesRange<Range, T> || ValuesRange<Range, T>
+T sampleMean(Range&& values) {
+	return sampleMoments<T>(values).mean;
+}
+
+
+template<std::floating_point T, std::ranges::sized_range Range>
+	requires VarSeriesRange<Range, T> || ValuesRange<Range, T>
+T biasedSampleVariance(Range&& values) {
+	return sampleMoments<T>(values).biasedVariance();
+}
+
+
+#ifdef __SIZEOF_INT128__
+using Int128 = __int128;
+#else
+using Int128 = boost::multiprecision::int128_t;
+#endif
+
+// Exact moments of a variational series with integer values and amounts: the sums of n, n*x and
+// n*x^2 are accumulated in 128-bit integers and converted to floating point only at the end.
+// Values up to 2^20 in magnitude and a total amount up to 2^40 keep n*sum(n*x^2) within 128 bits.
+// The higher moments do not fit, and are accumulated in floating point in the same pass.
+template<std::floating_point T, bool HigherMoments = false, std::ranges::sized_range Range>
+	requires VarSeriesRange<Range, T>
+std::optional<MomentAccumulator<T, HigherMoments>> exactIntegerMoments(Range&& series) {
+	constexpr T maxValue = 1 << 20;
+	constexpr std::int64_t maxCount = std::int64_t(1) << 40;
+
+	std::int64_t count = 0;
+	Int128 sum = 0, sumSquares = 0;
+	T min = std::numeric_limits<T>::infinity(), max = -std::numeric_limits<T>::infinity();
+	MomentAccumulator<T, HigherMoments> moments;
+	for (const auto& [value, amount] : series) {
+		if (value != std::trunc(value) || std::abs(value) > maxValue || amount != std::trunc(amount) || amount < 0 || amount > maxCount) {
+			return std::nullopt;
+		}
+		if (amount != 0) {
+			min = std::min<T>(min, value);
+			max = std::max<T>(max, value);
+		}
+		auto integerValue = static_cast<std::int64_t>(value), integerAmount = static_cast<std::int64_t>(amount);
+		count += integerAmount;
+		if (count > maxCount) return std::nullopt;
+		sum += Int128(integerAmount) * integerValue;
+		sumSquares += Int128(integerAmount) * integerValue * integerValue;
+		if constexpr (HigherMoments) moments.pushWeighted(value, amount);
+	}
+
+	if (count == 0) return moments;
+	moments.count = static_cast<T>(count);
+	// The sums exceed 2^53 within these limits, so they are divided as integers first and only the
+	// quotient, which is at most maxValue, and the fraction of the remainder are rounded.
+	moments.mean = static_cast<T>(sum / count) + static_cast<T>(sum % count) / moments.count;
+	Int128 scaledM2 = count * sumSquares - sum * sum;
+	moments.m2 = static_cast<T>(scaledM2 / count) + static_cast<T>(scaledM2 % count) / moments.count;
+	moments.min = min;
+	moments.max = max;
+	return moments;
+}
+
+
+template<std::floating_point T, std::ranges::sized_range Range>
+	requires std::is_convertible_v<std::ranges::range_value_t<Range>, T>
+inline auto makeVarSeries(Range&& values) {
+	return values | std::views::transform([](T value) -> std::pair<T, T> { return { value, 1 }; });
+}
+
+
+// Splits the range into fixed-size chunks, so the result does not depend on the number of threads.
+template<std::floating_point T, bool HigherMoments = false, std::ranges::sized_range Range>
+	requires VarSeriesRange<Range, T> || ValuesRange<Range, T>
+MomentAccumulator<T, HigherMoments> parallelSampleMoments(ThreadPool& pool, Range&& values) {
+	if constexpr (!std::ranges::random_access_range<Range>) {
+		return sampleMoments<T, HigherMoments>(values);
+	} else {
+		constexpr std::size_t chunkSize = 1 << 16;
+		std::size_t size = std::ranges::size(values);
+		std::vector<MomentAccumulator<T, HigherMoments>> partialMoments((size + chunkSize - 1) / chunkSize);
+		pool.parallelFor(partialMoments.size(), [&](std::size_t chunk) {
+			auto begin = std::ranges::begin(values) + chunk * chunkSize;
+			auto end = begin + std::min(chunkSize, size - chunk * chunkSize);
+			partialMoments[chunk] = sampleMoments<T, HigherMoments>(std::ranges::subrange(begin, end));
+		});
+
+		MomentAccumulator<T, HigherMoments> moments;
+		for (const auto& partial : partialMoments) moments.merge(partial);
+		return moments;
+	}
+}
+
+
+
+// The mean alone, for callers that do not need the variance. Each fixed-size chunk is summed relative
+// to its first value, as in the moments kernels, and the chunk means are merged by their weights.
+template<std::floating_point T, std::ranges::random_access_range Range>
+	requires ValuesRange<Range, T>
+T parallelSampleMean(ThreadPool& pool, Range&& values) {
+	constexpr std::size_t chunkSize = 1 << 16;
+	std::size_t size = std::ranges::size(values);
+	std::vector<double> chunkMeans((size + chunkSize - 1) / chunkSize);
+	pool.parallelFor(chunkMeans.size(), [&](std::size_t chunk) {
+		auto begin = std::ranges::begin(values) + chunk * chunkSize;
+		std::size_t count = std::min(chunkSize, size - chunk * chunkSize), i = 0;
+		double shift = begin[0];
+		std::array<double, 4> sums{};
+		for (; i + 4 <= count; i += 4) {
+			for (std::size_t lane = 0; lane < 4; lane++) sums[lane] += begin[i + lane] - shift;
+		}
+		double sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+		for (; i < count; i++) sum += begin[i] - shift;
+		chunkMeans[chunk] = shift + sum / count;
+	});
+
+	double mean = 0;
+	for (std::size_t chunk = 0; chunk < chunkMeans.size(); chunk++) {
+		std::size_t mergedCount = std::min(size, (chunk + 1) * chunkSize);
+		std::size_t count = mergedCount - chunk * chunkSize;
+		mean += (chunkMeans[chunk] - mean) * count / mergedCount;
+	}
+	return static_cast<T>(mean);
+}
+
+}
@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "MomentAccumulator.h"
+#include "ThreadPool.h"
+#include "ConfidenceIntervals.h"
+
+
+namespace probstats {
+
+// The values at the given 0-based ranks of the sorted values, found by parallel selection without
+// sorting or copying the sample. Pivots bracketing every rank are taken from a sorted regular subsample;
+// one parallel pass over fixed-size chunks counts the values below each bracket and gathers those
+// inside it, and introselect on the merged brackets finds the ranks. A rank that falls outside its
+// bracket, which takes a sample arranged against the subsample, is selected from a copy of the sample.
+// Throws std::invalid_argument for ranks past the end of the sample.
+std::vector<FloatType> orderStatistics(std::span<const FloatType> values, std::span<const std::uint64_t> ranks, ThreadPool& pool);
+
+// Whether every amount of the series is a count, which the series overloads below need.
+bool hasIntegerAmounts(std::span<const std::pair<FloatType, FloatType>> series);
+
+// The series holds (value, amount) pairs sorted by value; the ranks are found by a cumulative scan of the amounts.
+// The series overloads throw std::invalid_argument for amounts that are not integers, where ranks are not defined.
+std::vector<FloatType> orderStatistics(std::span<const std::pair<FloatType, FloatType>> series, std::span<const std::uint64_t> ranks);
+
+
+// Sample quantiles interpolated linearly between the order statistics around rank (n - 1) p,
+// the default definition of R and NumPy.
+std::vector<FloatType> exactQuantiles(std::span<const FloatType> values, std::span<const FloatType> probabilities, ThreadPool& pool);
+
+std::vector<FloatType> exactQuantiles(std::span<const std::pair<FloatType, FloatType>> series, std::span<const FloatType> probabilities);
+
+
+// Distribution-free confidence interval (X_(l), X_(n + 1 - l)) for the median, with l the largest rank for which
+// P(l <= B <= n - l) >= confidence, B ~ Binomial(n, 1/2). Throws std::invalid_argument for samples too small
+// for even (X_(1), X_(n)) to reach the confidence.
+ConfidenceInterval medianConfidenceInterval(std::span<const FloatType> values, FloatType confidence, ThreadPool& pool);
+
+ConfidenceInterval medianConfidenceInterval(std::span<const std::pair<FloatType, FloatType>> series, FloatType confidence);
+
+}
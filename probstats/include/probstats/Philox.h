@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "MomentAccumulator.h"
+
+
+namespace probstats {
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// Each block of four outputs is a function of the key and a 128-bit counter only, so any element of
+// a stream can be computed directly and a stream can be split between threads in any way.
+class Philox4x32 {
+public:
+	using Block = std::array<std::uint32_t, 4>;
+
+	// Different streams under the same seed are independent, e.g. one per simulation replicate.
+	explicit Philox4x32(std::uint64_t seed, std::uint64_t stream = 0) :
+		key{ static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32) }, stream(stream) {}
+
+	Block operator()(std::uint64_t counter) const {
+		Block block{ static_cast<std::uint32_t>(counter), static_cast<std::uint32_t>(counter >> 32),
+			static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32) };
+		auto roundKey = key;
+		for (int round = 0; round < 10; round++) {
+			std::uint64_t product0 = std::uint64_t{ 0xD2511F53 } * block[0];
+			std::uint64_t product1 = std::uint64_t{ 0xCD9E8D57 } * block[2];
+			block = {
+				static_cast<std::uint32_t>(product1 >> 32) ^ block[1] ^ roundKey[0], static_cast<std::uint32_t>(product1),
+				static_cast<std::uint32_t>(product0 >> 32) ^ block[3] ^ roundKey[1], static_cast<std::uint32_t>(product0)
+			};
+			roundKey[0] += 0x9E3779B9;
+			roundKey[1] += 0xBB67AE85;
+		}
+		return block;
+	}
+
+	// A uniform number in the open interval (0, 1) with 53 random bits.
+	static FloatType uniform(std::uint32_t high, std::uint32_t low) {
+		std::uint64_t bits = (std::uint64_t{ high } << 32 | low) >> 11;
+		return (static_cast<FloatType>(bits) + 0.5) * 0x1p-53;
+	}
+
+private:
+	std::array<std::uint32_t, 2> key;
+	std::uint64_t stream;
+};
+
+
+// Sequential uniform random bit generator over one Philox stream, for the standard library distributions.
+class PhiloxEngine {
+public:
+	using result_type = std::uint32_t;
+
+	PhiloxEngine(std::uint64_t seed, std::uint64_t stream) : generator(seed, stream) {}
+
+	static constexpr result_type min() {
+		return 0;
+	}
+
+	static constexpr result_type max() {
+		return UINT32_MAX;
+	}
+
+	result_type operator()() {
+		if (position == block.size()) {
+			block = generator(counter++);
+			position = 0;
+		}
+		return block[position++];
+	}
+
+private:
+	Philox4x32 generator;
+	Philox4x32::Block block{};
+	std::uint64_t counter = 0;
+	std::size_t position = block.size();
+};
+
+}
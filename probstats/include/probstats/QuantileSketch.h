@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "MomentAccumulator.h"
+#include "ThreadPool.h"
+
+
+namespace probstats {
+
+// Merging t-digest: weighted centroids sorted by mean, whose sizes are bounded by the arcsine scale
+// function so that they are small near the tails, which keeps the rank error of extreme quantiles low.
+// A sketch keeps O(compression) centroids whatever the amount of data, and sketches of parts of
+// a sample merge into a sketch of the whole.
+class QuantileSketch {
+public:
+	static constexpr FloatType defaultCompression = 200;
+
+	explicit QuantileSketch(FloatType compression = defaultCompression);
+
+	void add(FloatType value, FloatType weight = 1);
+	// Adds the values with a single compression, which does not sort them again if they are in ascending order.
+	void add(std::span<const FloatType> values);
+	void merge(const QuantileSketch& other);
+	// Merges the buffered values into the centroids.
+	void compress();
+
+	// Interpolates linearly between the centroids, with centroids of a single distinct value (such as
+	// the buckets of a variational series) taking the whole range of ranks they cover.
+	// Throws std::logic_error for an empty sketch.
+	FloatType quantile(FloatType probability);
+
+	FloatType totalWeight() const {
+		return weight;
+	}
+
+private:
+	struct Centroid {
+		FloatType mean, weight;
+		bool singleValue;
+	};
+
+	FloatType compression;
+	FloatType weight = 0;
+	FloatType min, max;
+	// The compressed centroids, sorted by mean, followed by the values added since the last compression.
+	std::vector<Centroid> centroids;
+	std::size_t compressedCount = 0;
+};
+
+
+// Moments and a quantile sketch of the same values.
+struct SampleSummary {
+	MomentAccumulator<FloatType, true> moments;
+	QuantileSketch quantiles;
+};
+
+// A sketch of the values that holds only the compressed centroids. The values are radix sorted and
+// compressed at once, rather than buffered and sorted by comparison in small batches.
+QuantileSketch valuesSketch(std::span<const FloatType> values, FloatType compression = QuantileSketch::defaultCompression);
+
+// A sketch of the values from per-chunk sketches merged in order, so that it does not depend on the
+// number of threads.
+QuantileSketch parallelQuantileSketch(ThreadPool& pool, std::span<const FloatType> values,
+	FloatType compression = QuantileSketch::defaultCompression);
+
+// Both summaries from a single pass, feeding each chunk to the moments kernel and then to the sketch
+// while it is in cache.
+SampleSummary parallelSampleSummary(ThreadPool& pool, std::span<const FloatType> values,
+	FloatType compression = QuantileSketch::defaultCompression);
+
+// The buckets of the series enter the sketch with their amounts as weights.
+QuantileSketch variationalSeriesSketch(std::span<const std::pair<FloatType, FloatType>> series,
+	FloatType compression = QuantileSketch::defaultCompression);
+
+}
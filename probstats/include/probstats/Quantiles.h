@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include "MomentAccumulator.h"
+
+
+namespace probstats {
+
+enum class QuantileMethod {
+	// Boost.Math, with the results cached.
+	Exact,
+	// The closed-form approximations from FastQuantiles.h, where they are cheaper than Boost; the exact
+	// cached quantiles otherwise.
+	Fast,
+};
+
+
+// Quantiles of the distributions the confidence intervals are built on. Exact values for the common
+// confidence levels and small degrees of freedom come from a table generated on first use, and
+// other arguments are kept in a shared LRU cache, so repeated evaluation is a lookup rather than
+// a root-finding run.
+FloatType normalQuantile(FloatType probability, QuantileMethod method = QuantileMethod::Exact);
+
+FloatType studentsTQuantile(FloatType degreesOfFreedom, FloatType probability, QuantileMethod method = QuantileMethod::Exact);
+
+FloatType chiSquaredQuantile(FloatType degreesOfFreedom, FloatType probability, QuantileMethod method = QuantileMethod::Exact);
+
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "MomentAccumulator.h"
+#include "ThreadPool.h"
+
+
+namespace probstats {
+
+// LSD radix sort of doubles on their IEEE-754 bit patterns, with the sign bit flipped for positive values
+// and all bits flipped for negative ones, so that the keys order as unsigned integers the way the values do
+// (negative zero before positive zero). Each pass over an 11-bit digit counts the digits of contiguous
+// blocks and scatters the blocks to their offsets, and passes over digits that all values share are skipped.
+// The sorter keeps its key buffers and counts between sorts, so the features that sort samples
+// repeatedly allocate them once.
+class RadixSorter {
+public:
+	void sort(std::span<FloatType> values);
+	// Counts and scatters the blocks on the threads of the pool.
+	void sort(std::span<FloatType> values, ThreadPool& pool);
+
+private:
+	template<class ForEachBlock>
+	void sortBlocks(std::span<FloatType> values, std::size_t blocks, ForEachBlock forEachBlock);
+
+	std::vector<std::uint64_t> keys;
+	std::vector<std::uint64_t> scratch;
+	std::vector<std::size_t> counts;
+};
+
+
+// The variational series of sorted values, with every run of equal values as one bucket.
+std::vector<std::pair<FloatType, FloatType>> runLengthEncode(std::span<const FloatType> sortedValues);
+
+}
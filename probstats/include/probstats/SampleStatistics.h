@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <span>
+#include <utility>
+
+#include "Moments.h"
+
+
+namespace probstats {
+
+struct SampleStatistics {
+	FloatType sampleSize = 0;
+	FloatType mean = 0;
+	FloatType biasedVariance = 0;
+	FloatType unbiasedVariance = 0;
+	FloatType biasedStandardDeviation = 0;
+	FloatType unbiasedStandardDeviation = 0;
+	// Moment estimators sqrt(n) * M3 / M2^1.5 and n * M4 / M2^2 - 3, zero for normal distributions.
+	FloatType skewness = 0;
+	FloatType excessKurtosis = 0;
+};
+
+
+SampleStatistics sampleStatistics(const MomentAccumulator<FloatType, true>& moments);
+
+SampleStatistics sampleStatistics(std::span<const FloatType> values, ThreadPool& pool);
+
+// The series holds (value, amount) pairs; integer series are summed exactly.
+SampleStatistics sampleStatistics(std::span<const std::pair<FloatType, FloatType>> series, ThreadPool& pool);
+
+
+// Moments of a series, up to the fourth, in a single pass; integer series are summed exactly up to the second.
+MomentAccumulator<FloatType, true> variationalSeriesMoments(std::span<const std::pair<FloatType, FloatType>> series, ThreadPool& pool);
+
+}
@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include <deque>
+#include <vector>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+
+namespace probstats {
+
+class ThreadPool {
+public:
+	explicit ThreadPool(std::size_t threadCount) {
+		for (std::size_t i = 1; i < threadCount; i++) {
+			workers.emplace_back([this](std::stop_token stopToken) { workerLoop(stopToken); });
+		}
+	}
+
+	~ThreadPool() {
+		for (auto& worker : workers) worker.request_stop();
+		tasksChanged.notify_all();
+	}
+
+	std::size_t size() const {
+		return workers.size() + 1;
+	}
+
+	template<class F>
+	auto submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+		std::packaged_task<std::invoke_result_t<F>()> packagedTask(std::forward<F>(task));
+		auto result = packagedTask.get_future();
+		{
+			std::lock_guard lock(tasksMutex);
+			tasks.emplace_back(std::move(packagedTask));
+		}
+		tasksChanged.notify_one();
+		return result;
+	}
+
+	// Waits for a task submitted to this pool, running queued tasks meanwhile so that
+	// tasks may wait on their own subtasks without starving the pool.
+	template<class R>
+	R wait(std::future<R>& future) {
+		while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			if (!runPendingTask()) future.wait();
+		}
+		return future.get();
+	}
+
+	// Calls body(i) for every i in [0, count) on the pool and the calling thread.
+	template<class F>
+	void parallelFor(std::size_t count, F&& body) {
+		std::atomic<std::size_t> nextIndex = 0;
+		auto work = [&] {
+			try {
+				for (std::size_t index; (index = nextIndex++) < count;) body(index);
+			} catch (...) {
+				nextIndex = count;
+				throw;
+			}
+		};
+
+		std::vector<std::future<void>> helpers;
+		for (std::size_t i = 1; i < std::min(count, size()); i++) helpers.push_back(submit(work));
+
+		std::exception_ptr error;
+		try {
+			work();
+		} catch (...) {
+			error = std::current_exception();
+		}
+		for (auto& helper : helpers) {
+			try {
+				wait(helper);
+			} catch (...) {
+				if (!error) error = std::current_exception();
+			}
+		}
+		if (error) std::rethrow_exception(error);
+	}
+
+private:
+	bool runPendingTask() {
+		std::move_only_function<void()> task;
+		{
+			std::lock_guard lock(tasksMutex);
+			if (tasks.empty()) return false;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+		return true;
+	}
+
+	void workerLoop(std::stop_token stopToken) {
+		while (true) {
+			std::move_only_function<void()> task;
+			{
+				std::unique_lock lock(tasksMutex);
+				if (!tasksChanged.wait(lock, stopToken, [this] { return !tasks.empty(); })) return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	std::mutex tasksMutex;
+	std::condition_variable_any tasksChanged;
+	std::deque<std::move_only_function<void()>> tasks;
+	std::vector<std::jthread> workers;
+};
+
+
+}
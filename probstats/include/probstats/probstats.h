@@ -0,0 +1,16 @@
+﻿#pragma once
+
+#include "MomentAccumulator.h"
+#include "ThreadPool.h"
+#include "Moments.h"
+#include "Quantiles.h"
+#include "FastQuantiles.h"
+#include "ConfidenceIntervals.h"
+#include "SampleStatistics.h"
+#include "Philox.h"
+#include "Generators.h"
+#include "CoverageSimulation.h"
+#include "Bootstrap.h"
+#include "QuantileSketch.h"
+#include "OrderStatistics.h"
+#include "RadixSort.h"
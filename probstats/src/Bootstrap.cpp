@@ -0,0 +1,223 @@
+﻿#include "probstats/Bootstrap.h"
+
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <format>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "probstats/Moments.h"
+#include "probstats/Philox.h"
+#include "probstats/Quantiles.h"
+#include "probstats/RadixSort.h"
+#include "probstats/SampleStatistics.h"
+
+
+namespace probstats {
+
+namespace {
+
+// Mean, unbiased variance and unbiased standard deviation, the statistics every resample is reduced to.
+using Statistics = std::array<FloatType, 3>;
+
+// Sums of the deviations of a sample from a fixed shift, the mean of the original sample, so that
+// the variances of resamples and jackknife samples follow without cancellation.
+struct ShiftedSums {
+	FloatType count = 0;
+	FloatType sum = 0;
+	FloatType squares = 0;
+
+	Statistics statistics(FloatType shift) const {
+		FloatType variance = (squares - sum * sum / count) / (count - 1);
+		return { shift + sum / count, variance, std::sqrt(variance) };
+	}
+};
+
+constexpr std::size_t jackknifeChunkSize = 1 << 16;
+
+// Resamples are drawn from streams with the top bit set, so that under the same seed they never reuse
+// the streams that generated samples are drawn from.
+constexpr std::uint64_t bootstrapStreams = std::uint64_t{ 1 } << 63;
+
+// Acceleration of each statistic, from the jackknife samples that leave out one observation.
+// deviation(i) and weight(i) give the deviation of observation group i from the shift and its size.
+template<class Deviation, class Weight>
+Statistics jackknifeAccelerations(std::size_t groups, Deviation deviation, Weight weight, const ShiftedSums& sums, FloatType shift, ThreadPool& pool) {
+	auto leaveOneOut = [&](FloatType leftOut) {
+		return ShiftedSums{ sums.count - 1, sums.sum - leftOut, sums.squares - leftOut * leftOut }.statistics(shift);
+	};
+	// Sums over the groups in fixed-size chunks merged in order, so the rounding does not depend on the number of threads.
+	auto sumOverGroups = [&](auto term) {
+		std::vector<std::array<Statistics, 2>> partialSums((groups + jackknifeChunkSize - 1) / jackknifeChunkSize);
+		pool.parallelFor(partialSums.size(), [&](std::size_t chunk) {
+			std::array<Statistics, 2> chunkSums{};
+			for (std::size_t i = chunk * jackknifeChunkSize; i < std::min(groups, (chunk + 1) * jackknifeChunkSize); i++) {
+				term(leaveOneOut(deviation(i)), weight(i), chunkSums);
+			}
+			partialSums[chunk] = chunkSums;
+		});
+		std::array<Statistics, 2> total{};
+		for (const auto& partial : partialSums) {
+			for (std::size_t k = 0; k < 3; k++) {
+				total[0][k] += partial[0][k];
+				total[1][k] += partial[1][k];
+			}
+		}
+		return total;
+	};
+
+	auto jackknifeMeans = sumOverGroups([](const Statistics& jackknife, FloatType amount, std::array<Statistics, 2>& chunkSums) {
+		for (std::size_t k = 0; k < 3; k++) chunkSums[0][k] += amount * jackknife[k];
+	})[0];
+	for (auto& mean : jackknifeMeans) mean /= sums.count;
+
+	auto moments = sumOverGroups([&](const Statistics& jackknife, FloatType amount, std::array<Statistics, 2>& chunkSums) {
+		for (std::size_t k = 0; k < 3; k++) {
+			FloatType difference = jackknifeMeans[k] - jackknife[k];
+			chunkSums[0][k] += amount * difference * difference;
+			chunkSums[1][k] += amount * difference * difference * difference;
+		}
+	});
+	Statistics accelerations{};
+	for (std::size_t k = 0; k < 3; k++) {
+		if (moments[0][k] > 0) accelerations[k] = moments[1][k] / (6 * std::pow(moments[0][k], 1.5));
+	}
+	return accelerations;
+}
+
+// Linear interpolation between the order statistics of a sorted sample.
+FloatType sortedQuantile(const std::vector<FloatType>& sorted, FloatType probability) {
+	if (std::isnan(probability)) return std::numeric_limits<FloatType>::quiet_NaN();
+	FloatType position = std::clamp<FloatType>(probability, 0, 1) * (sorted.size() - 1);
+	auto below = static_cast<std::size_t>(position);
+	auto above = std::min(below + 1, sorted.size() - 1);
+	return sorted[below] + (position - below) * (sorted[above] - sorted[below]);
+}
+
+FloatType normalDistributionFunction(FloatType x) {
+	return std::erfc(-x / std::numbers::sqrt2) / 2;
+}
+
+BootstrapIntervals bootstrapIntervals(std::vector<FloatType>& replicates, FloatType estimate, FloatType acceleration, FloatType confidence,
+	RadixSorter& sorter
+) {
+	sorter.sort(replicates);
+	FloatType alpha = 1 - confidence;
+	FloatType lowerQuantile = sortedQuantile(replicates, alpha / 2), upperQuantile = sortedQuantile(replicates, 1 - alpha / 2);
+
+	// The proportion is kept half a replicate away from 0 and 1, where the bias correction is infinite.
+	auto below = std::ranges::lower_bound(replicates, estimate) - replicates.begin();
+	FloatType halfReplicate = FloatType{ 0.5 } / replicates.size();
+	FloatType bias = normalQuantile(std::clamp(static_cast<FloatType>(below) / replicates.size(), halfReplicate, 1 - halfReplicate));
+	auto adjustedProbability = [&](FloatType probability) {
+		FloatType z = bias + normalQuantile(probability);
+		return normalDistributionFunction(bias + z / (1 - acceleration * z));
+	};
+
+	return {
+		{ lowerQuantile, upperQuantile },
+		{ 2 * estimate - upperQuantile, 2 * estimate - lowerQuantile },
+		{ sortedQuantile(replicates, adjustedProbability(alpha / 2)), sortedQuantile(replicates, adjustedProbability(1 - alpha / 2)) },
+	};
+}
+
+// Runs the resampling, resample(r) returning the shifted sums of resample r, and builds the intervals.
+template<class Resample>
+BootstrapReport bootstrapReport(const ShiftedSums& sums, FloatType shift, const Statistics& accelerations, FloatType confidence,
+	std::size_t replicates, ThreadPool& pool, Resample resample
+) {
+	std::array<std::vector<FloatType>, 3> replicateStatistics;
+	for (auto& statistic : replicateStatistics) statistic.resize(replicates);
+	pool.parallelFor(replicates, [&](std::size_t replicate) {
+		auto statistics = resample(replicate).statistics(shift);
+		for (std::size_t k = 0; k < 3; k++) replicateStatistics[k][replicate] = statistics[k];
+	});
+
+	auto estimates = sums.statistics(shift);
+	RadixSorter sorter;
+	return {
+		bootstrapIntervals(replicateStatistics[0], estimates[0], accelerations[0], confidence, sorter),
+		bootstrapIntervals(replicateStatistics[1], estimates[1], accelerations[1], confidence, sorter),
+		bootstrapIntervals(replicateStatistics[2], estimates[2], accelerations[2], confidence, sorter),
+	};
+}
+
+void checkBootstrapArguments(FloatType sampleSize, std::size_t replicates) {
+	if (!(sampleSize >= 3)) throw std::invalid_argument(std::format("Cannot bootstrap a sample of size {}", sampleSize));
+	if (replicates == 0) throw std::invalid_argument("Bootstrap needs at least one resample");
+}
+
+}
+
+
+BootstrapReport bootstrapConfidenceIntervals(std::span<const FloatType> values, FloatType confidence,
+	std::size_t replicates, std::uint64_t seed, ThreadPool& pool
+) {
+	checkBootstrapArguments(static_cast<FloatType>(values.size()), replicates);
+	auto moments = parallelSampleMoments<FloatType>(pool, values);
+	FloatType shift = moments.mean;
+	ShiftedSums sums{ moments.count, 0, moments.m2 };
+	auto accelerations = jackknifeAccelerations(values.size(),
+		[&](std::size_t i) { return values[i] - shift; }, [](std::size_t) { return FloatType{ 1 }; }, sums, shift, pool);
+
+	// Indices are drawn two per Philox block into a per-thread buffer, then gathered.
+	constexpr std::size_t indexBlockSize = 1 << 12;
+	return bootstrapReport(sums, shift, accelerations, confidence, replicates, pool, [&](std::size_t replicate) {
+		thread_local std::vector<std::size_t> indices;
+		indices.resize(indexBlockSize);
+		Philox4x32 generator(seed, bootstrapStreams | replicate);
+		ShiftedSums resampleSums{ sums.count };
+		for (std::size_t first = 0; first < values.size(); first += indexBlockSize) {
+			std::size_t count = std::min(indexBlockSize, values.size() - first);
+			for (std::size_t i = 0; i < count; i += 2) {
+				auto block = generator((first + i) / 2);
+				indices[i] = static_cast<std::size_t>(Philox4x32::uniform(block[0], block[1]) * values.size());
+				indices[i + 1] = static_cast<std::size_t>(Philox4x32::uniform(block[2], block[3]) * values.size());
+			}
+			for (std::size_t i = 0; i < count; i++) {
+				FloatType deviation = values[std::min(indices[i], values.size() - 1)] - shift;
+				resampleSums.sum += deviation;
+				resampleSums.squares += deviation * deviation;
+			}
+		}
+		return resampleSums;
+	});
+}
+
+BootstrapReport bootstrapConfidenceIntervals(std::span<const std::pair<FloatType, FloatType>> series, FloatType confidence,
+	std::size_t replicates, std::uint64_t seed, ThreadPool& pool
+) {
+	auto moments = variationalSeriesMoments(series, pool);
+	checkBootstrapArguments(moments.count, replicates);
+	FloatType shift = moments.mean;
+	ShiftedSums sums{ moments.count, 0, moments.m2 };
+	auto accelerations = jackknifeAccelerations(series.size(),
+		[&](std::size_t i) { return series[i].first - shift; }, [&](std::size_t i) { return series[i].second; }, sums, shift, pool);
+
+	// Amount of the buckets from each one to the last, for the conditional probabilities of the binomial chain.
+	std::vector<FloatType> remainingAmounts(series.size() + 1);
+	for (std::size_t i = series.size(); i-- > 0;) remainingAmounts[i] = remainingAmounts[i + 1] + series[i].second;
+	auto total = static_cast<std::uint64_t>(std::llround(moments.count));
+
+	return bootstrapReport(sums, shift, accelerations, confidence, replicates, pool, [&](std::size_t replicate) {
+		PhiloxEngine engine(seed, bootstrapStreams | replicate);
+		ShiftedSums resampleSums{ static_cast<FloatType>(total) };
+		std::uint64_t remaining = total;
+		for (std::size_t i = 0; i < series.size() && remaining > 0; i++) {
+			FloatType probability = std::min<FloatType>(1, series[i].second / remainingAmounts[i]);
+			std::uint64_t amount = i + 1 == series.size() ? remaining
+				: std::binomial_distribution<std::uint64_t>(remaining, probability)(engine);
+			remaining -= amount;
+			FloatType deviation = series[i].first - shift;
+			resampleSums.sum += amount * deviation;
+			resampleSums.squares += amount * deviation * deviation;
+		}
+		return resampleSums;
+	});
+}
+
+}
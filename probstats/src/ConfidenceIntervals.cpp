@@ -0,0 +1,165 @@
+﻿#include "probstats/ConfidenceIntervals.h"
+
+#include <cmath>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <initializer_list>
+#include <algorithm>
+#include <limits>
+
+#include "probstats/Quantiles.h"
+
+
+namespace probstats {
+
+namespace {
+
+void checkBatchSizes(std::initializer_list<std::size_t> sizes) {
+	for (std::size_t size : sizes) {
+		if (size != *sizes.begin()) throw std::invalid_argument("Batch interval arrays must have the same length");
+	}
+}
+
+// Quantiles for a batch, computed once per distinct (degrees of freedom, probability) pair. There are
+// few distinct probabilities, one per confidence level, and the degrees of freedom are usually integer,
+// so most pairs are memoized in dense arrays indexed by the degrees of freedom; the rest go to a hash map.
+template<class Quantile>
+std::vector<FloatType> batchQuantiles(std::span<const FloatType> degreesOfFreedom, std::span<const FloatType> probabilities,
+	Quantile&& quantile
+) {
+	constexpr std::size_t maxDenseProbabilities = 16;
+	constexpr FloatType denseLimit = 1 << 16;
+	struct PairHash {
+		std::size_t operator()(const std::pair<FloatType, FloatType>& key) const {
+			return std::hash<FloatType>()(key.first) * 31 + std::hash<FloatType>()(key.second);
+		}
+	};
+	std::vector<FloatType> denseProbabilities;
+	std::vector<std::vector<FloatType>> dense;
+	std::unordered_map<std::pair<FloatType, FloatType>, FloatType, PairHash> sparse;
+
+	std::vector<FloatType> quantiles(degreesOfFreedom.size());
+	for (std::size_t i = 0; i < quantiles.size(); i++) {
+		FloatType freedom = degreesOfFreedom[i], probability = probabilities[i];
+		std::size_t row = std::ranges::find(denseProbabilities, probability) - denseProbabilities.begin();
+		if (row == denseProbabilities.size() && denseProbabilities.size() < maxDenseProbabilities) {
+			denseProbabilities.push_back(probability);
+			dense.emplace_back();
+		}
+		if (row < denseProbabilities.size() && freedom >= 0 && freedom < denseLimit && freedom == std::trunc(freedom)) {
+			auto column = static_cast<std::size_t>(freedom);
+			if (dense[row].size() <= column) dense[row].resize(column + 1, std::numeric_limits<FloatType>::quiet_NaN());
+			if (std::isnan(dense[row][column])) dense[row][column] = quantile(freedom, probability);
+			quantiles[i] = dense[row][column];
+		} else {
+			auto [entry, inserted] = sparse.try_emplace({ freedom, probability });
+			if (inserted) entry->second = quantile(freedom, probability);
+			quantiles[i] = entry->second;
+		}
+	}
+	return quantiles;
+}
+
+}
+
+
+ConfidenceInterval meanConfidenceIntervalWithKnownVariance(
+	FloatType sampleSize, FloatType statMean, FloatType variance, FloatType confidence,
+	QuantileMethod method
+) {
+	auto quantile = normalQuantile((confidence + 1) / 2, method);
+	auto epsilon = std::sqrt(variance / sampleSize) * quantile;
+	return { statMean - epsilon, statMean + epsilon };
+}
+
+ConfidenceInterval meanConfidenceIntervalWithUnknownVariance(
+	FloatType sampleSize, FloatType statMean, FloatType statUnbiasedVariance, FloatType confidence,
+	QuantileMethod method
+) {
+	auto quantile = studentsTQuantile(sampleSize - 1, (confidence + 1) / 2, method);
+	auto epsilon = std::sqrt(statUnbiasedVariance / sampleSize) * quantile;
+	return { statMean - epsilon, statMean + epsilon };
+}
+
+
+ConfidenceInterval varianceConfidenceInterval(
+	FloatType sampleSize, FloatType statUnbiasedVariance, FloatType confidence,
+	QuantileMethod method
+) {
+	auto chi1 = chiSquaredQuantile(sampleSize - 1, (1 + confidence) / 2, method);
+	auto chi2 = chiSquaredQuantile(sampleSize - 1, (1 - confidence) / 2, method);
+	return { statUnbiasedVariance * (sampleSize - 1) / chi1, statUnbiasedVariance * (sampleSize - 1) / chi2 };
+}
+
+
+
+// The batch functions first derive the quantile arguments, then resolve the quantiles, and finally
+// apply the interval arithmetic in plain loops over contiguous arrays.
+void meanConfidenceIntervalsWithKnownVariance(
+	std::span<const FloatType> sampleSizes, std::span<const FloatType> statMeans, std::span<const FloatType> variances,
+	std::span<const FloatType> confidences, std::span<FloatType> lowers, std::span<FloatType> uppers,
+	QuantileMethod method
+) {
+	checkBatchSizes({ sampleSizes.size(), statMeans.size(), variances.size(), confidences.size(), lowers.size(), uppers.size() });
+	std::vector<FloatType> degreesOfFreedom(sampleSizes.size()), probabilities(sampleSizes.size());
+	for (std::size_t i = 0; i < probabilities.size(); i++) probabilities[i] = (confidences[i] + 1) / 2;
+	auto quantiles = batchQuantiles(degreesOfFreedom, probabilities, [method](FloatType, FloatType probability) {
+		return normalQuantile(probability, method);
+	});
+
+	for (std::size_t i = 0; i < quantiles.size(); i++) {
+		FloatType epsilon = std::sqrt(variances[i] / sampleSizes[i]) * quantiles[i];
+		lowers[i] = statMeans[i] - epsilon;
+		uppers[i] = statMeans[i] + epsilon;
+	}
+}
+
+void meanConfidenceIntervalsWithUnknownVariance(
+	std::span<const FloatType> sampleSizes, std::span<const FloatType> statMeans, std::span<const FloatType> statUnbiasedVariances,
+	std::span<const FloatType> confidences, std::span<FloatType> lowers, std::span<FloatType> uppers,
+	QuantileMethod method
+) {
+	checkBatchSizes({ sampleSizes.size(), statMeans.size(), statUnbiasedVariances.size(), confidences.size(), lowers.size(), uppers.size() });
+	std::vector<FloatType> degreesOfFreedom(sampleSizes.size()), probabilities(sampleSizes.size());
+	for (std::size_t i = 0; i < probabilities.size(); i++) {
+		degreesOfFreedom[i] = sampleSizes[i] - 1;
+		probabilities[i] = (confidences[i] + 1) / 2;
+	}
+	auto quantiles = batchQuantiles(degreesOfFreedom, probabilities, [method](FloatType freedom, FloatType probability) {
+		return studentsTQuantile(freedom, probability, method);
+	});
+
+	for (std::size_t i = 0; i < quantiles.size(); i++) {
+		FloatType epsilon = std::sqrt(statUnbiasedVariances[i] / sampleSizes[i]) * quantiles[i];
+		lowers[i] = statMeans[i] - epsilon;
+		uppers[i] = statMeans[i] + epsilon;
+	}
+}
+
+void varianceConfidenceIntervals(
+	std::span<const FloatType> sampleSizes, std::span<const FloatType> statUnbiasedVariances,
+	std::span<const FloatType> confidences, std::span<FloatType> lowers, std::span<FloatType> uppers,
+	QuantileMethod method
+) {
+	checkBatchSizes({ sampleSizes.size(), statUnbiasedVariances.size(), confidences.size(), lowers.size(), uppers.size() });
+	std::vector<FloatType> degreesOfFreedom(sampleSizes.size()), upperProbabilities(sampleSizes.size()), lowerProbabilities(sampleSizes.size());
+	for (std::size_t i = 0; i < degreesOfFreedom.size(); i++) {
+		degreesOfFreedom[i] = sampleSizes[i] - 1;
+		upperProbabilities[i] = (1 + confidences[i]) / 2;
+		lowerProbabilities[i] = (1 - confidences[i]) / 2;
+	}
+	auto chiSquared = [method](FloatType freedom, FloatType probability) {
+		return chiSquaredQuantile(freedom, probability, method);
+	};
+	auto chi1 = batchQuantiles(degreesOfFreedom, upperProbabilities, chiSquared);
+	auto chi2 = batchQuantiles(degreesOfFreedom, lowerProbabilities, chiSquared);
+
+	for (std::size_t i = 0; i < degreesOfFreedom.size(); i++) {
+		FloatType scaledVariance = statUnbiasedVariances[i] * degreesOfFreedom[i];
+		lowers[i] = scaledVariance / chi1[i];
+		uppers[i] = scaledVariance / chi2[i];
+	}
+}
+
+}
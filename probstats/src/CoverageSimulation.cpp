@@ -0,0 +1,90 @@
+﻿#include "probstats/CoverageSimulation.h"
+
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <format>
+#include <stdexcept>
+#include <vector>
+
+#include "probstats/Moments.h"
+#include "probstats/ConfidenceIntervals.h"
+
+
+namespace probstats {
+
+namespace {
+
+constexpr std::size_t replicateBlockSize = 1024;
+
+struct ReplicateBlock {
+	std::vector<FloatType> values;
+	std::vector<FloatType> sampleSizes, means, variances, unbiasedVariances, confidences, lowers, uppers;
+
+	void resize(std::size_t sampleSize, std::size_t replicates) {
+		values.resize(sampleSize);
+		for (auto* column : { &sampleSizes, &means, &variances, &unbiasedVariances, &confidences, &lowers, &uppers }) column->resize(replicates);
+	}
+};
+
+std::uint64_t countCovering(const ReplicateBlock& block, FloatType parameter) {
+	std::uint64_t covered = 0;
+	for (std::size_t i = 0; i < block.lowers.size(); i++) covered += block.lowers[i] <= parameter && parameter <= block.uppers[i];
+	return covered;
+}
+
+CoverageEstimate coverageEstimate(std::uint64_t covered, std::uint64_t replicates) {
+	FloatType coverage = static_cast<FloatType>(covered) / replicates;
+	return { coverage, std::sqrt(coverage * (1 - coverage) / replicates) };
+}
+
+}
+
+
+CoverageReport simulateCoverage(const SampleGenerator& generator, std::uint64_t sampleSize, std::uint64_t replicates,
+	FloatType confidence, ThreadPool& pool, QuantileMethod method
+) {
+	if (sampleSize < 2 || replicates == 0) {
+		throw std::invalid_argument(std::format("Cannot simulate {} replicates of size {}", replicates, sampleSize));
+	}
+
+	std::vector<std::array<std::uint64_t, 3>> blockCovered((replicates + replicateBlockSize - 1) / replicateBlockSize);
+	pool.parallelFor(blockCovered.size(), [&](std::size_t blockIndex) {
+		thread_local ReplicateBlock block;
+		std::uint64_t firstReplicate = blockIndex * replicateBlockSize;
+		std::size_t blockReplicates = std::min<std::uint64_t>(replicateBlockSize, replicates - firstReplicate);
+		block.resize(sampleSize, blockReplicates);
+
+		for (std::size_t i = 0; i < blockReplicates; i++) {
+			generator.generate((firstReplicate + i) * sampleSize, block.values);
+			auto moments = contiguousSampleMoments(block.values.data(), block.values.size());
+			block.sampleSizes[i] = static_cast<FloatType>(sampleSize);
+			block.means[i] = moments.mean;
+			block.variances[i] = generator.variance();
+			block.unbiasedVariances[i] = moments.biasedVariance() * moments.count / (moments.count - 1);
+			block.confidences[i] = confidence;
+		}
+
+		auto& covered = blockCovered[blockIndex];
+		meanConfidenceIntervalsWithKnownVariance(block.sampleSizes, block.means, block.variances, block.confidences,
+			block.lowers, block.uppers, method);
+		covered[0] = countCovering(block, generator.mean());
+		meanConfidenceIntervalsWithUnknownVariance(block.sampleSizes, block.means, block.unbiasedVariances, block.confidences,
+			block.lowers, block.uppers, method);
+		covered[1] = countCovering(block, generator.mean());
+		varianceConfidenceIntervals(block.sampleSizes, block.unbiasedVariances, block.confidences, block.lowers, block.uppers, method);
+		covered[2] = countCovering(block, generator.variance());
+	});
+
+	std::array<std::uint64_t, 3> covered{};
+	for (const auto& block : blockCovered) {
+		for (std::size_t i = 0; i < covered.size(); i++) covered[i] += block[i];
+	}
+	return {
+		coverageEstimate(covered[0], replicates),
+		coverageEstimate(covered[1], replicates),
+		coverageEstimate(covered[2], replicates),
+	};
+}
+
+}
@@ -0,0 +1,162 @@
+﻿#include "probstats/FastQuantiles.h"
+
+#include <cmath>
+#include <numbers>
+#include <algorithm>
+#include <limits>
+
+#include <boost/math/special_functions/gamma.hpp>
+#include <boost/math/distributions/students_t.hpp>
+
+
+namespace probstats {
+
+namespace {
+
+constexpr FloatType infinity = std::numeric_limits<FloatType>::infinity();
+
+// The quantile at probability 0 or 1 is the end of the support; other probabilities outside (0, 1)
+// have none.
+FloatType boundaryQuantile(FloatType probability, FloatType lowest, FloatType highest) {
+	if (probability == 0) return lowest;
+	if (probability == 1) return highest;
+	return std::numeric_limits<FloatType>::quiet_NaN();
+}
+
+}
+
+// Wichura's PPND16 rational approximations, in three ranges of the distance from the median.
+FloatType fastNormalQuantile(FloatType probability) {
+	if (!(probability > 0 && probability < 1)) return boundaryQuantile(probability, -infinity, infinity);
+	FloatType q = probability - 0.5;
+	if (std::abs(q) <= 0.425) {
+		FloatType r = 0.180625 - q * q;
+		return q * (((((((r * 2509.0809287301226727 + 33430.575583588128105) * r + 67265.770927008700853) * r
+			+ 45921.953931549871457) * r + 13731.693765509461125) * r + 1971.5909503065514427) * r + 133.14166789178437745) * r
+			+ 3.387132872796366608)
+			/ (((((((r * 5226.495278852545925 + 28729.085735721942674) * r + 39307.89580009271061) * r
+			+ 21213.794301586595867) * r + 5394.1960214247511077) * r + 687.1870074920579083) * r + 42.313330701600911252) * r + 1);
+	}
+
+	FloatType r = std::sqrt(-std::log(q < 0 ? probability : 1 - probability));
+	FloatType value;
+	if (r <= 5) {
+		r -= 1.6;
+		value = (((((((r * 7.7454501427834140764e-4 + 0.0227238449892691845833) * r + 0.24178072517745061177) * r
+			+ 1.27045825245236838258) * r + 3.64784832476320460504) * r + 5.7694972214606914055) * r + 4.6303378461565452959) * r
+			+ 1.42343711074968357734)
+			/ (((((((r * 1.05075007164441684324e-9 + 5.475938084995344946e-4) * r + 0.0151986665636164571966) * r
+			+ 0.14810397642748007459) * r + 0.68976733498510000455) * r + 1.6763848301838038494) * r + 2.05319162663775882187) * r + 1);
+	} else {
+		r -= 5;
+		value = (((((((r * 2.01033439929228813265e-7 + 2.71155556874348757815e-5) * r + 0.0012426609473880784386) * r
+			+ 0.026532189526576123093) * r + 0.29656057182850489123) * r + 1.7848265399172913358) * r + 5.4637849111641143699) * r
+			+ 6.6579046435011037772)
+			/ (((((((r * 2.04426310338993978564e-15 + 1.4215117583164458887e-7) * r + 1.8463183175100546818e-5) * r
+			+ 7.868691311456132591e-4) * r + 0.0148753612908506148525) * r + 0.13692988092273580531) * r + 0.59983220655588793769) * r + 1);
+	}
+	return q < 0 ? -value : value;
+}
+
+
+// Exact closed forms for one and two degrees of freedom. Elsewhere a series in the distance from
+// the median is used close to it, and Hill's algorithm 396, written for the two-tailed probability
+// of exceeding |t|, further out.
+FloatType fastStudentsTQuantile(FloatType degreesOfFreedom, FloatType probability) {
+	if (!(probability > 0 && probability < 1)) return boundaryQuantile(probability, -infinity, infinity);
+	FloatType n = degreesOfFreedom;
+	// Exact for probabilities from 1/4 on, so the distance keeps its relative accuracy near the median.
+	FloatType fromMedian = probability - 0.5;
+	if (n == 1) {
+		if (std::abs(fromMedian) <= 0.25) return std::tan(std::numbers::pi * fromMedian);
+		return (fromMedian < 0 ? -1 : 1) / std::tan(std::numbers::pi * std::min(probability, 1 - probability));
+	}
+	if (n == 2) return 2 * fromMedian / std::sqrt(2 * probability * (1 - probability));
+
+	// The series of the quantile in v = (p - 1/2) / f(0), where f is the density, truncated after
+	// the v^9 term, whose successor is below 1e-17 of the result for |p - 1/2| < 0.01.
+	if (std::abs(fromMedian) < 0.01) {
+		FloatType v = fromMedian * std::sqrt(n * std::numbers::pi) * boost::math::tgamma_delta_ratio(n / 2, 0.5);
+		FloatType v2 = v * v;
+		FloatType c3 = (n + 1) / (6 * n);
+		FloatType c5 = (n + 1) * (7 * n + 1) / (120 * n * n);
+		FloatType c7 = (n + 1) * ((127 * n + 8) * n + 1) / (5040 * n * n * n);
+		FloatType c9 = (n + 1) * (((4369 * n - 537) * n + 135) * n + 1) / (362880 * n * n * n * n);
+		return v * (1 + v2 * (c3 + v2 * (c5 + v2 * (c7 + v2 * c9))));
+	}
+
+	FloatType twoTailed = 2 * std::min(probability, 1 - probability);
+	FloatType a = 1 / (n - 0.5);
+	FloatType b = 48 / (a * a);
+	FloatType c = ((20700 * a / b - 98) * a - 16) * a + 96.36;
+	FloatType d = ((94.5 / (b + c) - 3) / b + 1) * std::sqrt(a * std::numbers::pi / 2) * n;
+	FloatType y = std::pow(d * twoTailed, 2 / n);
+	if (y > 0.05 + a) {
+		FloatType x = fastNormalQuantile(twoTailed / 2);
+		y = x * x;
+		if (n < 5) c += 0.3 * (n - 4.5) * (x + 0.6);
+		c = (((0.05 * d * x - 5) * x - 7) * x - 2) * x + b + c;
+		y = (((((0.4 * y + 6.3) * y + 36) * y + 94.5) / c - y - 3) / b + 1) * x;
+		y = std::expm1(a * y * y);
+	} else {
+		y = ((1 / (((n + 6) / (n * y) - 0.089 * d - 0.822) * (n + 2) * 3) + 0.5 / (n + 4)) * y - 1) * (n + 1) / (n + 2) + 1 / y;
+	}
+	FloatType t = std::sqrt(n * y);
+
+	// The expansion loses accuracy for few degrees of freedom, so it is polished there with Newton
+	// steps on the upper tail of the distribution, until a step is small enough, relative to t or
+	// to the rounding of the residual, for quadratic convergence to have reached rounding level.
+	if (n < studentsTRefinementLimit) {
+		boost::math::students_t distribution(n);
+		for (int step = 0; step < 8; step++) {
+			FloatType density = boost::math::pdf(distribution, t);
+			FloatType newtonStep = (boost::math::cdf(boost::math::complement(distribution, t)) - twoTailed / 2) / density;
+			t += newtonStep;
+			if (std::abs(newtonStep) <= 1e-8 * t + 1e-16 / density) break;
+		}
+	}
+	return probability < 0.5 ? -t : t;
+}
+
+
+// The starting point is the Wilson-Hilferty cube-root approximation for few degrees of freedom and
+// the Cornish-Fisher expansion up to the nu^(-3/2) term otherwise. For many degrees of freedom and
+// moderate tails the expansion is used on its own; elsewhere it is refined by Newton steps in log x
+// on the regularised incomplete gamma function, which keep the iterate positive. The residual is
+// taken in the tail the probability lies in, so that it does not cancel near 1, and iteration stops
+// once a step is small enough for quadratic convergence to have reached rounding level.
+FloatType fastChiSquaredQuantile(FloatType degreesOfFreedom, FloatType probability) {
+	if (!(probability > 0 && probability < 1)) return boundaryQuantile(probability, 0, infinity);
+	FloatType z = fastNormalQuantile(probability);
+	FloatType x;
+	if (degreesOfFreedom >= 100) {
+		FloatType root = std::sqrt(2 * degreesOfFreedom), z2 = z * z;
+		x = degreesOfFreedom + root * z + 2 * (z2 - 1) / 3 + z * (z2 - 7) / (9 * root)
+			- (6 * z2 * z2 + 14 * z2 - 32) / (405 * degreesOfFreedom) + z * ((9 * z2 + 256) * z2 - 433) / (4860 * degreesOfFreedom * root);
+		if (degreesOfFreedom >= chiSquaredRefinementLimit && std::abs(z) <= 5) return x;
+	} else {
+		FloatType spread = 2 / (9 * degreesOfFreedom);
+		FloatType cubeRoot = 1 - spread + z * std::sqrt(spread);
+		x = degreesOfFreedom * cubeRoot * cubeRoot * cubeRoot;
+	}
+
+	FloatType shape = degreesOfFreedom / 2;
+	if (!(x > 0)) {
+		// Far in the lower tail, P(shape, x / 2) ~ (x / 2)^shape / Gamma(shape + 1).
+		x = 2 * std::pow(probability * std::tgamma(shape + 1), 1 / shape);
+	}
+
+	bool lowerTail = probability < 0.5;
+	for (int step = 0; step < 32; step++) {
+		FloatType residual = lowerTail ? boost::math::gamma_p(shape, x / 2) - probability
+			: (1 - probability) - boost::math::gamma_q(shape, x / 2);
+		FloatType slope = boost::math::gamma_p_derivative(shape, x / 2) * x / 2;
+		if (!(slope > 0)) break;
+		FloatType logStep = std::clamp(residual / slope, -1.0, 1.0);
+		x *= std::exp(-logStep);
+		if (std::abs(logStep) <= 1e-8) break;
+	}
+	return x;
+}
+
+}
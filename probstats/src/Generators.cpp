@@ -0,0 +1,215 @@
+﻿#include "probstats/Generators.h"
+
+#include <cmath>
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+#include "probstats/Moments.h"
+#include "probstats/FastQuantiles.h"
+
+
+namespace probstats {
+
+namespace {
+
+template<class... Visitors>
+struct Overloaded : Visitors... {
+	using Visitors::operator()...;
+};
+
+// Probabilities below this fraction of the mode's are dropped from the tables: they are far below
+// the resolution of the 53-bit uniform numbers the tables are searched with.
+constexpr FloatType negligibleProbability = 1e-20;
+constexpr std::size_t maxSupportSize = 1 << 24;
+
+// Distribution function of a unimodal discrete distribution over the integers around its mode,
+// built from the ratios of the probabilities of neighbouring values. nextRatio(k) is P(k + 1) / P(k)
+// and previousRatio(k) is P(k - 1) / P(k).
+template<class NextRatio, class PreviousRatio>
+std::vector<FloatType> discreteDistributionTable(FloatType mode, FloatType min, FloatType max,
+	NextRatio nextRatio, PreviousRatio previousRatio, FloatType& firstValue
+) {
+	// The size is checked as the table grows: for huge modes the ratios stay near 1 for billions of
+	// steps, and beyond 2^53 the value stops changing at all.
+	std::vector<FloatType> below, above{ 1 };
+	auto checkSize = [&] {
+		if (below.size() + above.size() >= maxSupportSize) throw std::invalid_argument("The distribution is too wide to be tabulated");
+	};
+	for (FloatType value = mode, probability = 1; value > min; value--) {
+		probability *= previousRatio(value);
+		if (probability < negligibleProbability) break;
+		checkSize();
+		below.push_back(probability);
+	}
+	for (FloatType value = mode, probability = 1; value < max; value++) {
+		probability *= nextRatio(value);
+		if (probability < negligibleProbability) break;
+		checkSize();
+		above.push_back(probability);
+	}
+
+	firstValue = mode - static_cast<FloatType>(below.size());
+	std::vector<FloatType> cumulative(below.rbegin(), below.rend());
+	cumulative.insert(cumulative.end(), above.begin(), above.end());
+	FloatType sum = 0;
+	for (auto& probability : cumulative) probability = sum += probability;
+	for (auto& probability : cumulative) probability /= sum;
+	cumulative.back() = 1;
+	return cumulative;
+}
+
+}
+
+
+SampleGenerator::SampleGenerator(const SampleDistribution& distribution, std::uint64_t seed, std::uint64_t stream) :
+	distribution(distribution), generator(seed, stream)
+{
+	std::visit(Overloaded{
+		[](const NormalDistribution& normal) {
+			if (!std::isfinite(normal.mean) || !(normal.standardDeviation > 0) || !std::isfinite(normal.standardDeviation)) {
+				throw std::invalid_argument(std::format("Invalid normal distribution ({}, {})", normal.mean, normal.standardDeviation));
+			}
+		},
+		[](const ExponentialDistribution& exponential) {
+			if (!(exponential.rate > 0) || !std::isfinite(exponential.rate)) {
+				throw std::invalid_argument(std::format("Invalid exponential distribution rate {}", exponential.rate));
+			}
+		},
+		[this](const PoissonDistribution& poisson) {
+			FloatType lambda = poisson.mean;
+			if (!(lambda > 0) || !std::isfinite(lambda)) throw std::invalid_argument(std::format("Invalid Poisson distribution mean {}", lambda));
+			cumulativeProbabilities = discreteDistributionTable(std::floor(lambda), 0, std::numeric_limits<FloatType>::infinity(),
+				[lambda](FloatType k) { return lambda / (k + 1); },
+				[lambda](FloatType k) { return k / lambda; },
+				firstValue);
+		},
+		[this](const HypergeometricDistribution& hypergeometric) {
+			auto [population, successes, draws] = hypergeometric;
+			if (population == 0 || successes > population || draws > population) {
+				throw std::invalid_argument(std::format("Invalid hypergeometric distribution ({}, {}, {})", population, successes, draws));
+			}
+			FloatType N = static_cast<FloatType>(population), K = static_cast<FloatType>(successes), n = static_cast<FloatType>(draws);
+			FloatType min = std::max<FloatType>(0, n + K - N), max = std::min(n, K);
+			FloatType mode = std::clamp(std::floor((n + 1) * (K + 1) / (N + 2)), min, max);
+			cumulativeProbabilities = discreteDistributionTable(mode, min, max,
+				[=](FloatType k) { return (K - k) * (n - k) / ((k + 1) * (N - K - n + k + 1)); },
+				[=](FloatType k) { return k * (N - K - n + k) / ((K - k + 1) * (n - k + 1)); },
+				firstValue);
+		},
+	}, distribution);
+}
+
+FloatType SampleGenerator::operator()(std::uint64_t index) const {
+	auto block = generator(index);
+	FloatType u = Philox4x32::uniform(block[0], block[1]);
+	if (isDiscrete()) {
+		auto found = std::ranges::upper_bound(cumulativeProbabilities, u);
+		auto offset = std::min<std::size_t>(found - cumulativeProbabilities.begin(), cumulativeProbabilities.size() - 1);
+		return firstValue + static_cast<FloatType>(offset);
+	}
+	if (auto normal = std::get_if<NormalDistribution>(&distribution)) {
+		return normal->mean + normal->standardDeviation * fastNormalQuantile(u);
+	}
+	return -std::log(u) / std::get<ExponentialDistribution>(distribution).rate;
+}
+
+void SampleGenerator::generate(std::uint64_t first, std::span<FloatType> values) const {
+	for (std::size_t i = 0; i < values.size(); i++) values[i] = (*this)(first + i);
+}
+
+FloatType SampleGenerator::mean() const {
+	return std::visit(Overloaded{
+		[](const NormalDistribution& normal) { return normal.mean; },
+		[](const ExponentialDistribution& exponential) { return 1 / exponential.rate; },
+		[](const PoissonDistribution& poisson) { return poisson.mean; },
+		[](const HypergeometricDistribution& hypergeometric) {
+			return static_cast<FloatType>(hypergeometric.draws) * hypergeometric.successes / hypergeometric.population;
+		},
+	}, distribution);
+}
+
+FloatType SampleGenerator::variance() const {
+	return std::visit(Overloaded{
+		[](const NormalDistribution& normal) { return normal.standardDeviation * normal.standardDeviation; },
+		[](const ExponentialDistribution& exponential) { return 1 / (exponential.rate * exponential.rate); },
+		[](const PoissonDistribution& poisson) { return poisson.mean; },
+		[](const HypergeometricDistribution& hypergeometric) {
+			FloatType N = static_cast<FloatType>(hypergeometric.population), K = static_cast<FloatType>(hypergeometric.successes);
+			FloatType n = static_cast<FloatType>(hypergeometric.draws);
+			if (N <= 1) return FloatType{ 0 };
+			return n * K / N * (N - K) / N * (N - n) / (N - 1);
+		},
+	}, distribution);
+}
+
+
+constexpr std::size_t generatorChunkSize = 1 << 16;
+
+void generateSample(const SampleGenerator& generator, std::uint64_t first, std::span<FloatType> values, ThreadPool& pool) {
+	pool.parallelFor((values.size() + generatorChunkSize - 1) / generatorChunkSize, [&](std::size_t chunk) {
+		auto chunkValues = values.subspan(chunk * generatorChunkSize, std::min(generatorChunkSize, values.size() - chunk * generatorChunkSize));
+		generator.generate(first + chunk * generatorChunkSize, chunkValues);
+	});
+}
+
+// Chunks are merged in order, so the rounding of the result does not depend on the number of threads either.
+MomentAccumulator<FloatType, true> generatedSampleMoments(const SampleGenerator& generator, std::uint64_t size, ThreadPool& pool) {
+	std::vector<MomentAccumulator<FloatType, true>> partialMoments((size + generatorChunkSize - 1) / generatorChunkSize);
+	pool.parallelFor(partialMoments.size(), [&](std::size_t chunk) {
+		thread_local std::vector<FloatType> values;
+		values.resize(std::min<std::uint64_t>(generatorChunkSize, size - chunk * generatorChunkSize));
+		generator.generate(chunk * generatorChunkSize, values);
+		partialMoments[chunk] = contiguousSampleMoments<FloatType, true>(values.data(), values.size());
+	});
+
+	MomentAccumulator<FloatType, true> moments;
+	for (const auto& partial : partialMoments) moments.merge(partial);
+	return moments;
+}
+
+SampleSummary generatedSampleSummary(const SampleGenerator& generator, std::uint64_t size, ThreadPool& pool, FloatType compression) {
+	std::size_t chunks = (size + generatorChunkSize - 1) / generatorChunkSize;
+	std::vector<MomentAccumulator<FloatType, true>> partialMoments(chunks);
+	std::vector<QuantileSketch> partialSketches(chunks, QuantileSketch(compression));
+	pool.parallelFor(chunks, [&](std::size_t chunk) {
+		thread_local std::vector<FloatType> values;
+		values.resize(std::min<std::uint64_t>(generatorChunkSize, size - chunk * generatorChunkSize));
+		generator.generate(chunk * generatorChunkSize, values);
+		partialMoments[chunk] = contiguousSampleMoments<FloatType, true>(values.data(), values.size());
+		partialSketches[chunk] = valuesSketch(values, compression);
+	});
+
+	SampleSummary summary{ {}, QuantileSketch(compression) };
+	for (std::size_t chunk = 0; chunk < chunks; chunk++) {
+		summary.moments.merge(partialMoments[chunk]);
+		summary.quantiles.merge(partialSketches[chunk]);
+	}
+	return summary;
+}
+
+// Every thread counts a contiguous part of the sample; integer counts add up the same however the sample is split.
+std::vector<std::pair<FloatType, FloatType>> generateVariationalSeries(const SampleGenerator& generator, std::uint64_t size, ThreadPool& pool) {
+	if (!generator.isDiscrete()) throw std::invalid_argument("Variational series can only be generated for discrete distributions");
+
+	std::size_t partCount = pool.size();
+	std::vector<std::vector<std::uint64_t>> partCounts(partCount);
+	pool.parallelFor(partCount, [&](std::size_t part) {
+		auto& counts = partCounts[part];
+		counts.assign(generator.supportSize(), 0);
+		for (std::uint64_t index = size * part / partCount, end = size * (part + 1) / partCount; index < end; index++) {
+			counts[static_cast<std::size_t>(generator(index) - generator.supportMin())]++;
+		}
+	});
+
+	std::vector<std::pair<FloatType, FloatType>> series;
+	for (std::size_t offset = 0; offset < generator.supportSize(); offset++) {
+		std::uint64_t amount = 0;
+		for (const auto& counts : partCounts) amount += counts[offset];
+		if (amount != 0) series.emplace_back(generator.supportMin() + static_cast<FloatType>(offset), static_cast<FloatType>(amount));
+	}
+	return series;
+}
+
+}
@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <optional>
+#include <utility>
+
+
+namespace probstats {
+
+// Fixed-capacity map that evicts the least recently used entry. Not synchronised.
+template<class Key, class Value, class Hash = std::hash<Key>>
+class LruCache {
+public:
+	explicit LruCache(std::size_t capacity) : capacity(capacity) {}
+
+	std::optional<Value> find(const Key& key) {
+		auto position = positions.find(key);
+		if (position == positions.end()) return std::nullopt;
+		entries.splice(entries.begin(), entries, position->second);
+		return position->second->second;
+	}
+
+	void insert(const Key& key, Value value) {
+		if (auto position = positions.find(key); position != positions.end()) {
+			position->second->second = std::move(value);
+			entries.splice(entries.begin(), entries, position->second);
+			return;
+		}
+		if (entries.size() == capacity) {
+			positions.erase(entries.back().first);
+			entries.pop_back();
+		}
+		entries.emplace_front(key, std::move(value));
+		positions.emplace(key, entries.begin());
+	}
+
+private:
+	std::size_t capacity;
+	// Most recently used first.
+	std::list<std::pair<Key, Value>> entries;
+	std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hash> positions;
+};
+
+}
@@ -0,0 +1,271 @@
+﻿#include "probstats/OrderStatistics.h"
+
+#include <cmath>
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/math/distributions/binomial.hpp>
+
+#include "probstats/RadixSort.h"
+
+
+namespace probstats {
+
+namespace {
+
+constexpr std::size_t selectionChunkSize = 1 << 16;
+// Samples up to this size are selected from a copy directly.
+constexpr std::size_t directSelectionLimit = 1 << 16;
+// Size of the regular subsample the pivots are taken from, and how many of its ranks each bracket extends
+// to either side of the estimated position of its ranks, about four standard deviations of that estimate.
+constexpr std::size_t pivotSampleSize = 1 << 16;
+constexpr std::size_t bracketMargin = 512;
+
+// Values of [ranks[first], ranks[last]) in the values, which are reordered. Selecting the middle rank
+// splits the values for the ranks on either side, so each level of the recursion takes one pass over them.
+void selectRanks(std::span<FloatType> values, std::span<const std::uint64_t> ranks, std::span<FloatType> selected) {
+	if (ranks.empty()) return;
+	std::size_t middle = ranks.size() / 2;
+	auto nth = values.begin() + ranks[middle];
+	std::nth_element(values.begin(), nth, values.end());
+	selected[middle] = *nth;
+
+	selectRanks(values.first(ranks[middle]), ranks.first(middle), selected.first(middle));
+	std::vector<std::uint64_t> upperRanks;
+	for (std::uint64_t rank : ranks.subspan(middle + 1)) upperRanks.push_back(rank - ranks[middle] - 1);
+	selectRanks(values.subspan(ranks[middle] + 1), upperRanks, selected.subspan(middle + 1));
+}
+
+// Ranks sorted and without repeats, for selection.
+std::vector<std::uint64_t> distinctRanks(std::span<const std::uint64_t> ranks, std::uint64_t size) {
+	std::vector<std::uint64_t> sorted(ranks.begin(), ranks.end());
+	std::ranges::sort(sorted);
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+	if (!sorted.empty() && sorted.back() >= size) {
+		throw std::invalid_argument(std::format("Rank {} is out of a sample of {} values", sorted.back(), size));
+	}
+	return sorted;
+}
+
+std::vector<FloatType> inRequestedOrder(std::span<const std::uint64_t> ranks, std::span<const std::uint64_t> sortedRanks,
+	std::span<const FloatType> selected
+) {
+	std::vector<FloatType> statistics;
+	for (std::uint64_t rank : ranks) statistics.push_back(selected[std::ranges::lower_bound(sortedRanks, rank) - sortedRanks.begin()]);
+	return statistics;
+}
+
+// Number of values in the series, whose amounts have to be counts for the ranks to be defined.
+std::uint64_t seriesSize(std::span<const std::pair<FloatType, FloatType>> series) {
+	if (!hasIntegerAmounts(series)) throw std::invalid_argument("Order statistics of a variational series need integer amounts");
+	FloatType total = 0;
+	for (const auto& [value, amount] : series) total += amount;
+	return static_cast<std::uint64_t>(total);
+}
+
+// A range of values expected to hold a run of the ranks, and what one pass over the sample found out about it.
+struct Bracket {
+	FloatType lower, upper;
+	std::size_t firstRank, lastRank;
+	std::uint64_t countBelow = 0;
+	std::vector<FloatType> inside;
+};
+
+std::vector<Bracket> rankBrackets(std::span<const FloatType> values, std::span<const std::uint64_t> ranks) {
+	std::vector<FloatType> subsample(pivotSampleSize);
+	for (std::size_t i = 0; i < pivotSampleSize; i++) subsample[i] = values[i * values.size() / pivotSampleSize];
+	RadixSorter().sort(subsample);
+
+	std::vector<Bracket> brackets;
+	for (std::size_t i = 0; i < ranks.size(); i++) {
+		std::size_t position = ranks[i] * pivotSampleSize / values.size();
+		FloatType lower = subsample[position - std::min(position, bracketMargin)];
+		FloatType upper = subsample[std::min(pivotSampleSize - 1, position + bracketMargin)];
+		if (!brackets.empty() && lower <= brackets.back().upper) {
+			brackets.back().upper = std::max(brackets.back().upper, upper);
+			brackets.back().lastRank = i + 1;
+		} else {
+			brackets.push_back({ lower, upper, i, i + 1, 0, {} });
+		}
+	}
+	return brackets;
+}
+
+}
+
+
+bool hasIntegerAmounts(std::span<const std::pair<FloatType, FloatType>> series) {
+	return std::ranges::all_of(series, [](FloatType amount) { return amount >= 0 && amount == std::trunc(amount); },
+		&std::pair<FloatType, FloatType>::second);
+}
+
+std::vector<FloatType> orderStatistics(std::span<const FloatType> values, std::span<const std::uint64_t> ranks, ThreadPool& pool) {
+	auto sortedRanks = distinctRanks(ranks, values.size());
+	std::vector<FloatType> selected(sortedRanks.size());
+	if (values.size() <= directSelectionLimit) {
+		std::vector<FloatType> copy(values.begin(), values.end());
+		selectRanks(copy, sortedRanks, selected);
+		return inRequestedOrder(ranks, sortedRanks, selected);
+	}
+
+	auto brackets = rankBrackets(values, sortedRanks);
+	// The upper bounds are shifted by one to line up with the count of lower bounds reached,
+	// with no values inside before the first bracket.
+	std::vector<FloatType> lowers, uppers{ -std::numeric_limits<FloatType>::infinity() };
+	for (const auto& bracket : brackets) {
+		lowers.push_back(bracket.lower);
+		uppers.push_back(bracket.upper);
+	}
+
+	// The brackets are disjoint and sorted, so the number of lower bounds a value reaches is the index of
+	// the only bracket it may be in, and a histogram of these indices counts the values below every bracket.
+	struct ChunkBrackets {
+		std::vector<std::uint64_t> histogram;
+		std::vector<std::vector<FloatType>> inside;
+	};
+	std::size_t chunks = (values.size() + selectionChunkSize - 1) / selectionChunkSize;
+	std::vector<ChunkBrackets> partialBrackets(chunks);
+	pool.parallelFor(chunks, [&](std::size_t chunk) {
+		auto chunkValues = values.subspan(chunk * selectionChunkSize, std::min(selectionChunkSize, values.size() - chunk * selectionChunkSize));
+		ChunkBrackets found{ std::vector<std::uint64_t>(brackets.size() + 1), std::vector<std::vector<FloatType>>(brackets.size()) };
+		for (FloatType value : chunkValues) {
+			std::size_t reached = 0;
+			for (FloatType lower : lowers) reached += value >= lower;
+			found.histogram[reached]++;
+			if (value <= uppers[reached]) found.inside[reached - 1].push_back(value);
+		}
+		partialBrackets[chunk] = std::move(found);
+	});
+
+	for (std::size_t i = 0; i < brackets.size(); i++) {
+		auto& bracket = brackets[i];
+		for (auto& chunkBrackets : partialBrackets) {
+			for (std::size_t below = 0; below <= i; below++) bracket.countBelow += chunkBrackets.histogram[below];
+			bracket.inside.insert(bracket.inside.end(), chunkBrackets.inside[i].begin(), chunkBrackets.inside[i].end());
+			chunkBrackets.inside[i] = {};
+		}
+	}
+	pool.parallelFor(brackets.size(), [&](std::size_t i) {
+		auto& bracket = brackets[i];
+		std::vector<std::uint64_t> localRanks;
+		std::size_t first = bracket.firstRank;
+		while (first < bracket.lastRank && sortedRanks[first] < bracket.countBelow) first++;
+		std::size_t last = first;
+		while (last < bracket.lastRank && sortedRanks[last] < bracket.countBelow + bracket.inside.size()) {
+			localRanks.push_back(sortedRanks[last++] - bracket.countBelow);
+		}
+		bracket.firstRank = first;
+		bracket.lastRank = last;
+		selectRanks(bracket.inside, localRanks, std::span(selected).subspan(first, last - first));
+	});
+
+	// Ranks that fell outside their brackets.
+	std::vector<std::size_t> missedPositions;
+	std::size_t next = 0;
+	for (const auto& bracket : brackets) {
+		for (; next < bracket.firstRank; next++) missedPositions.push_back(next);
+		next = bracket.lastRank;
+	}
+	for (; next < sortedRanks.size(); next++) missedPositions.push_back(next);
+	if (!missedPositions.empty()) {
+		std::vector<std::uint64_t> missed;
+		for (std::size_t position : missedPositions) missed.push_back(sortedRanks[position]);
+		std::vector<FloatType> copy(values.begin(), values.end()), missedSelected(missed.size());
+		selectRanks(copy, missed, missedSelected);
+		for (std::size_t i = 0; i < missedPositions.size(); i++) selected[missedPositions[i]] = missedSelected[i];
+	}
+	return inRequestedOrder(ranks, sortedRanks, selected);
+}
+
+std::vector<FloatType> orderStatistics(std::span<const std::pair<FloatType, FloatType>> series, std::span<const std::uint64_t> ranks) {
+	auto sortedRanks = distinctRanks(ranks, seriesSize(series));
+
+	std::vector<FloatType> selected;
+	FloatType countThrough = 0;
+	auto bucket = series.begin();
+	for (std::uint64_t rank : sortedRanks) {
+		while (countThrough + bucket->second <= rank) countThrough += (bucket++)->second;
+		selected.push_back(bucket->first);
+	}
+	return inRequestedOrder(ranks, sortedRanks, selected);
+}
+
+
+namespace {
+
+// Ranks of the order statistics around (n - 1) p, and the weight of the upper one.
+struct QuantileRanks {
+	std::vector<std::uint64_t> ranks;
+	std::vector<FloatType> fractions;
+};
+
+QuantileRanks quantileRanks(std::uint64_t size, std::span<const FloatType> probabilities) {
+	if (size == 0) throw std::invalid_argument("Quantiles of an empty sample");
+	QuantileRanks quantileRanks;
+	for (FloatType probability : probabilities) {
+		if (!(probability >= 0 && probability <= 1)) throw std::invalid_argument(std::format("Probability {} is out of [0, 1]", probability));
+		FloatType position = (size - 1) * probability;
+		auto lower = static_cast<std::uint64_t>(std::floor(position));
+		quantileRanks.ranks.push_back(lower);
+		quantileRanks.ranks.push_back(std::min(lower + 1, size - 1));
+		quantileRanks.fractions.push_back(position - lower);
+	}
+	return quantileRanks;
+}
+
+std::vector<FloatType> interpolatedQuantiles(const QuantileRanks& quantileRanks, std::span<const FloatType> statistics) {
+	std::vector<FloatType> quantiles;
+	for (std::size_t i = 0; i < quantileRanks.fractions.size(); i++) {
+		FloatType lower = statistics[2 * i], upper = statistics[2 * i + 1];
+		quantiles.push_back(lower + (upper - lower) * quantileRanks.fractions[i]);
+	}
+	return quantiles;
+}
+
+// The 0-based ranks of the bounds of the median interval.
+std::pair<std::uint64_t, std::uint64_t> medianIntervalRanks(std::uint64_t size, FloatType confidence) {
+	if (!(confidence > 0 && confidence < 1)) throw std::invalid_argument(std::format("Confidence {} is out of (0, 1)", confidence));
+	FloatType tail = (1 - confidence) / 2;
+	if (size == 0 || std::ldexp(FloatType(1), -static_cast<int>(std::min<std::uint64_t>(size, 2000))) > tail) {
+		throw std::invalid_argument(std::format("A sample of {} values is too small for a median interval of confidence {}", size, confidence));
+	}
+
+	// The largest k with P(B <= k) <= tail, starting from the quantile of the distribution.
+	boost::math::binomial_distribution<FloatType> binomial(static_cast<FloatType>(size), 0.5);
+	auto k = static_cast<std::uint64_t>(boost::math::quantile(binomial, tail));
+	while (k > 0 && boost::math::cdf(binomial, static_cast<FloatType>(k)) > tail) k--;
+	while (boost::math::cdf(binomial, static_cast<FloatType>(k + 1)) <= tail) k++;
+	return { k, size - 1 - k };
+}
+
+}
+
+
+std::vector<FloatType> exactQuantiles(std::span<const FloatType> values, std::span<const FloatType> probabilities, ThreadPool& pool) {
+	auto ranks = quantileRanks(values.size(), probabilities);
+	return interpolatedQuantiles(ranks, orderStatistics(values, ranks.ranks, pool));
+}
+
+std::vector<FloatType> exactQuantiles(std::span<const std::pair<FloatType, FloatType>> series, std::span<const FloatType> probabilities) {
+	auto ranks = quantileRanks(seriesSize(series), probabilities);
+	return interpolatedQuantiles(ranks, orderStatistics(series, ranks.ranks));
+}
+
+
+ConfidenceInterval medianConfidenceInterval(std::span<const FloatType> values, FloatType confidence, ThreadPool& pool) {
+	auto [lower, upper] = medianIntervalRanks(values.size(), confidence);
+	std::uint64_t ranks[] = { lower, upper };
+	auto bounds = orderStatistics(values, ranks, pool);
+	return { bounds[0], bounds[1] };
+}
+
+ConfidenceInterval medianConfidenceInterval(std::span<const std::pair<FloatType, FloatType>> series, FloatType confidence) {
+	auto [lower, upper] = medianIntervalRanks(seriesSize(series), confidence);
+	std::uint64_t ranks[] = { lower, upper };
+	auto bounds = orderStatistics(series, ranks);
+	return { bounds[0], bounds[1] };
+}
+
+}
@@ -0,0 +1,166 @@
+﻿#include "probstats/QuantileSketch.h"
+#include "probstats/Moments.h"
+#include "probstats/RadixSort.h"
+
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <stdexcept>
+#include <algorithm>
+
+
+namespace probstats {
+
+namespace {
+
+constexpr std::size_t sketchChunkSize = 1 << 16;
+
+}
+
+
+QuantileSketch::QuantileSketch(FloatType compression) :
+	compression(compression), min(std::numeric_limits<FloatType>::infinity()), max(-std::numeric_limits<FloatType>::infinity()) {
+	if (!(compression >= 10)) throw std::invalid_argument("Quantile sketch compression must be at least 10");
+}
+
+void QuantileSketch::add(FloatType value, FloatType valueWeight) {
+	if (valueWeight == 0) return;
+	centroids.push_back({ value, valueWeight, true });
+	weight += valueWeight;
+	min = std::min(min, value);
+	max = std::max(max, value);
+	if (centroids.size() - compressedCount >= 8 * static_cast<std::size_t>(compression)) compress();
+}
+
+void QuantileSketch::add(std::span<const FloatType> values) {
+	centroids.reserve(centroids.size() + values.size());
+	for (FloatType value : values) {
+		centroids.push_back({ value, 1, true });
+		min = std::min(min, value);
+		max = std::max(max, value);
+	}
+	weight += values.size();
+	compress();
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+	if (other.weight == 0) return;
+	centroids.insert(centroids.end(), other.centroids.begin(), other.centroids.end());
+	weight += other.weight;
+	min = std::min(min, other.min);
+	max = std::max(max, other.max);
+	compress();
+}
+
+// A centroid starting at quantile q may grow until the scale k(q) = compression / (2 pi) * asin(2q - 1)
+// increases by one. Centroids of the same single value are always merged.
+void QuantileSketch::compress() {
+	if (centroids.size() == compressedCount) return;
+	auto buffered = centroids.begin() + compressedCount;
+	if (!std::ranges::is_sorted(buffered, centroids.end(), {}, &Centroid::mean)) std::ranges::sort(buffered, centroids.end(), {}, &Centroid::mean);
+	std::ranges::inplace_merge(centroids, buffered, {}, &Centroid::mean);
+
+	auto scale = [&](FloatType quantile) {
+		return compression / (2 * std::numbers::pi) * std::asin(2 * quantile - 1);
+	};
+	auto weightLimit = [&](FloatType weightBefore) {
+		FloatType limit = scale(weightBefore / weight) + 1;
+		if (limit >= compression / 4) return weight;
+		return weight * (std::sin(2 * std::numbers::pi * limit / compression) + 1) / 2;
+	};
+
+	std::size_t merged = 0;
+	FloatType weightBefore = 0, limit = weightLimit(0);
+	for (std::size_t i = 1; i < centroids.size(); i++) {
+		auto& current = centroids[merged];
+		const auto& next = centroids[i];
+		bool sameValue = current.singleValue && next.singleValue && current.mean == next.mean;
+		if (sameValue || weightBefore + current.weight + next.weight <= limit) {
+			current.weight += next.weight;
+			current.mean += (next.mean - current.mean) * next.weight / current.weight;
+			current.singleValue = sameValue;
+		} else {
+			weightBefore += current.weight;
+			limit = weightLimit(weightBefore);
+			centroids[++merged] = next;
+		}
+	}
+	centroids.resize(merged + 1);
+	compressedCount = centroids.size();
+}
+
+FloatType QuantileSketch::quantile(FloatType probability) {
+	if (weight == 0) throw std::logic_error("Quantile of an empty sketch");
+	compress();
+
+	std::vector<std::pair<FloatType, FloatType>> points{ { 0, min } };
+	FloatType weightBefore = 0;
+	for (const auto& centroid : centroids) {
+		if (centroid.singleValue) {
+			points.emplace_back(weightBefore, centroid.mean);
+			points.emplace_back(weightBefore + centroid.weight, centroid.mean);
+		} else {
+			points.emplace_back(weightBefore + centroid.weight / 2, centroid.mean);
+		}
+		weightBefore += centroid.weight;
+	}
+	points.emplace_back(weight, max);
+
+	FloatType rank = probability * weight;
+	auto upper = std::ranges::lower_bound(points, rank, {}, &std::pair<FloatType, FloatType>::first);
+	if (upper == points.begin()) return min;
+	if (upper == points.end()) return max;
+	auto lower = std::prev(upper);
+	if (upper->first == lower->first) return upper->second;
+	return lower->second + (upper->second - lower->second) * (rank - lower->first) / (upper->first - lower->first);
+}
+
+
+// The sketch is returned as a copy, which holds only the compressed centroids and not the buffer.
+QuantileSketch valuesSketch(std::span<const FloatType> values, FloatType compression) {
+	thread_local RadixSorter sorter;
+	thread_local std::vector<FloatType> sorted;
+	sorted.assign(values.begin(), values.end());
+	sorter.sort(sorted);
+	QuantileSketch sketch(compression);
+	sketch.add(sorted);
+	return QuantileSketch(sketch);
+}
+
+QuantileSketch parallelQuantileSketch(ThreadPool& pool, std::span<const FloatType> values, FloatType compression) {
+	std::vector<QuantileSketch> partialSketches((values.size() + sketchChunkSize - 1) / sketchChunkSize, QuantileSketch(compression));
+	pool.parallelFor(partialSketches.size(), [&](std::size_t chunk) {
+		partialSketches[chunk] = valuesSketch(values.subspan(chunk * sketchChunkSize, std::min(sketchChunkSize, values.size() - chunk * sketchChunkSize)), compression);
+	});
+
+	QuantileSketch sketch(compression);
+	for (const auto& partial : partialSketches) sketch.merge(partial);
+	return sketch;
+}
+
+SampleSummary parallelSampleSummary(ThreadPool& pool, std::span<const FloatType> values, FloatType compression) {
+	std::size_t chunks = (values.size() + sketchChunkSize - 1) / sketchChunkSize;
+	std::vector<MomentAccumulator<FloatType, true>> partialMoments(chunks);
+	std::vector<QuantileSketch> partialSketches(chunks, QuantileSketch(compression));
+	pool.parallelFor(chunks, [&](std::size_t chunk) {
+		auto chunkValues = values.subspan(chunk * sketchChunkSize, std::min(sketchChunkSize, values.size() - chunk * sketchChunkSize));
+		partialMoments[chunk] = contiguousSampleMoments<FloatType, true>(chunkValues.data(), chunkValues.size());
+		partialSketches[chunk] = valuesSketch(chunkValues, compression);
+	});
+
+	SampleSummary summary{ {}, QuantileSketch(compression) };
+	for (std::size_t chunk = 0; chunk < chunks; chunk++) {
+		summary.moments.merge(partialMoments[chunk]);
+		summary.quantiles.merge(partialSketches[chunk]);
+	}
+	return summary;
+}
+
+QuantileSketch variationalSeriesSketch(std::span<const std::pair<FloatType, FloatType>> series, FloatType compression) {
+	QuantileSketch sketch(compression);
+	for (const auto& [value, amount] : series) sketch.add(value, amount);
+	sketch.compress();
+	return sketch;
+}
+
+}
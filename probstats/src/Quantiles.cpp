@@ -0,0 +1,133 @@
+﻿#include "probstats/Quantiles.h"
+
+#include <array>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include <boost/math/distributions/normal.hpp>
+#include <boost/math/distributions/students_t.hpp>
+#include <boost/math/distributions/chi_squared.hpp>
+
+#include "probstats/FastQuantiles.h"
+#include "LruCache.h"
+
+
+namespace probstats {
+
+namespace {
+
+enum class Distribution { Normal, StudentsT, ChiSquared };
+
+struct QuantileKey {
+	Distribution distribution;
+	FloatType degreesOfFreedom;
+	FloatType probability;
+
+	bool operator==(const QuantileKey&) const = default;
+};
+
+struct QuantileKeyHash {
+	std::size_t operator()(const QuantileKey& key) const {
+		std::size_t hash = std::hash<FloatType>()(key.degreesOfFreedom);
+		hash = hash * 31 + std::hash<FloatType>()(key.probability);
+		return hash * 31 + static_cast<std::size_t>(key.distribution);
+	}
+};
+
+
+FloatType computeQuantile(const QuantileKey& key) {
+	switch (key.distribution) {
+	case Distribution::Normal: return boost::math::quantile(boost::math::normal(), key.probability);
+	case Distribution::StudentsT: return boost::math::quantile(boost::math::students_t(key.degreesOfFreedom), key.probability);
+	default: return boost::math::quantile(boost::math::chi_squared(key.degreesOfFreedom), key.probability);
+	}
+}
+
+
+constexpr std::array<FloatType, 3> tableConfidences{ 0.9, 0.95, 0.99 };
+constexpr std::size_t tableMaxDegreesOfFreedom = 100;
+
+struct TableRow {
+	Distribution distribution;
+	FloatType probability;
+};
+
+// The probabilities are derived from the confidence levels with the same expressions as
+// in the interval functions, so that lookups match bit for bit.
+constexpr auto tableRows = [] {
+	std::array<TableRow, 4 * tableConfidences.size()> rows{};
+	for (std::size_t i = 0; i < tableConfidences.size(); i++) {
+		FloatType confidence = tableConfidences[i];
+		rows[4 * i] = { Distribution::Normal, (confidence + 1) / 2 };
+		rows[4 * i + 1] = { Distribution::StudentsT, (confidence + 1) / 2 };
+		rows[4 * i + 2] = { Distribution::ChiSquared, (1 + confidence) / 2 };
+		rows[4 * i + 3] = { Distribution::ChiSquared, (1 - confidence) / 2 };
+	}
+	return rows;
+}();
+
+// Table of quantiles for the common confidence levels and integer degrees of freedom, filled on first
+// use of each entry. None of the tabulated quantiles is zero, so zero marks an entry not computed yet.
+std::atomic<FloatType>* tableEntry(const QuantileKey& key) {
+	static std::array<std::array<std::atomic<FloatType>, tableMaxDegreesOfFreedom + 1>, tableRows.size()> table{};
+
+	std::size_t column = 0;
+	if (key.distribution != Distribution::Normal) {
+		if (!(key.degreesOfFreedom >= 1 && key.degreesOfFreedom <= tableMaxDegreesOfFreedom)) return nullptr;
+		if (key.degreesOfFreedom != std::trunc(key.degreesOfFreedom)) return nullptr;
+		column = static_cast<std::size_t>(key.degreesOfFreedom);
+	}
+	for (std::size_t row = 0; row < tableRows.size(); row++) {
+		if (tableRows[row].distribution == key.distribution && tableRows[row].probability == key.probability) {
+			return &table[row][column];
+		}
+	}
+	return nullptr;
+}
+
+FloatType cachedQuantile(const QuantileKey& key) {
+	// Non-finite arguments cannot be used as keys and are rejected by Boost anyway.
+	if (!std::isfinite(key.degreesOfFreedom) || !std::isfinite(key.probability)) return computeQuantile(key);
+
+	if (auto entry = tableEntry(key)) {
+		FloatType value = entry->load(std::memory_order_relaxed);
+		if (value == 0) {
+			value = computeQuantile(key);
+			entry->store(value, std::memory_order_relaxed);
+		}
+		return value;
+	}
+
+	static std::mutex cacheMutex;
+	static LruCache<QuantileKey, FloatType, QuantileKeyHash> cache(4096);
+	{
+		std::lock_guard lock(cacheMutex);
+		if (auto value = cache.find(key)) return *value;
+	}
+	FloatType value = computeQuantile(key);
+	std::lock_guard lock(cacheMutex);
+	cache.insert(key, value);
+	return value;
+}
+
+}
+
+
+FloatType normalQuantile(FloatType probability, QuantileMethod method) {
+	if (method == QuantileMethod::Fast) return fastNormalQuantile(probability);
+	return cachedQuantile({ Distribution::Normal, 0, probability });
+}
+
+FloatType studentsTQuantile(FloatType degreesOfFreedom, FloatType probability, QuantileMethod method) {
+	if (method == QuantileMethod::Fast && degreesOfFreedom >= studentsTRefinementLimit) return fastStudentsTQuantile(degreesOfFreedom, probability);
+	return cachedQuantile({ Distribution::StudentsT, degreesOfFreedom, probability });
+}
+
+FloatType chiSquaredQuantile(FloatType degreesOfFreedom, FloatType probability, QuantileMethod method) {
+	if (method == QuantileMethod::Fast && degreesOfFreedom >= chiSquaredRefinementLimit) return fastChiSquaredQuantile(degreesOfFreedom, probability);
+	return cachedQuantile({ Distribution::ChiSquared, degreesOfFreedom, probability });
+}
+
+}
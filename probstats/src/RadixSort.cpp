@@ -0,0 +1,134 @@
+﻿#include "probstats/RadixSort.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+
+namespace probstats {
+
+namespace {
+
+constexpr int digitBits = 11;
+constexpr std::size_t digitValues = std::size_t{ 1 } << digitBits;
+constexpr int digitCount = (64 + digitBits - 1) / digitBits;
+// Shorter samples are sorted by comparison.
+constexpr std::size_t radixSortThreshold = 1 << 12;
+constexpr std::uint64_t signBit = std::uint64_t{ 1 } << 63;
+
+// Keys are kept as integers: many of them are NaN bit patterns, which passing them around as doubles
+// may change, for example when x87 code loads and stores a signalling NaN.
+std::uint64_t toKey(FloatType value) {
+	auto bits = std::bit_cast<std::uint64_t>(value);
+	return bits ^ ((0 - (bits >> 63)) | signBit);
+}
+
+FloatType fromKey(std::uint64_t key) {
+	return std::bit_cast<FloatType>(key ^ (((key >> 63) - 1) | signBit));
+}
+
+std::size_t digit(std::uint64_t key, int position) {
+	return (key >> (position * digitBits)) & (digitValues - 1);
+}
+
+}
+
+
+template<class ForEachBlock>
+void RadixSorter::sortBlocks(std::span<FloatType> values, std::size_t blocks, ForEachBlock forEachBlock) {
+	std::size_t size = values.size();
+	auto blockRange = [&](std::size_t block) {
+		return std::pair{ block * size / blocks, (block + 1) * size / blocks };
+	};
+	keys.resize(size);
+	scratch.resize(size);
+	counts.assign(blocks * digitValues * digitCount, 0);
+
+	// The first pass converts the values to keys and counts every digit. These counts tell which digits all
+	// values share, and serve the first pass that scatters, which sees the same blocks. A scatter moves other
+	// values into each block, so later passes recount their digit, unless the values form a single block.
+	forEachBlock([&](std::size_t block) {
+		auto [begin, end] = blockRange(block);
+		std::size_t* blockCounts = counts.data() + block * digitValues * digitCount;
+		for (std::size_t i = begin; i < end; i++) {
+			keys[i] = toKey(values[i]);
+			for (int position = 0; position < digitCount; position++) blockCounts[position * digitValues + digit(keys[i], position)]++;
+		}
+	});
+	std::array<bool, digitCount> shared{};
+	for (int position = 0; position < digitCount; position++) {
+		std::size_t first = digit(keys[0], position);
+		std::size_t total = 0;
+		for (std::size_t block = 0; block < blocks; block++) total += counts[(block * digitCount + position) * digitValues + first];
+		shared[position] = total == size;
+	}
+
+	std::uint64_t* source = keys.data();
+	std::uint64_t* destination = scratch.data();
+	bool counted = true;
+	std::vector<std::size_t> offsets(blocks * digitValues);
+	for (int position = 0; position < digitCount; position++) {
+		if (shared[position]) continue;
+		std::size_t countsStride = counted ? digitValues * digitCount : digitValues;
+		std::size_t countsOffset = counted ? position * digitValues : 0;
+		if (!counted) {
+			forEachBlock([&](std::size_t block) {
+				auto [begin, end] = blockRange(block);
+				std::size_t* blockCounts = counts.data() + block * digitValues;
+				std::fill_n(blockCounts, digitValues, 0);
+				for (std::size_t i = begin; i < end; i++) blockCounts[digit(source[i], position)]++;
+			});
+		}
+
+		// Block b writes its values with digit d after all smaller digits and after the values of earlier blocks with digit d.
+		std::size_t offset = 0;
+		for (std::size_t value = 0; value < digitValues; value++) {
+			for (std::size_t block = 0; block < blocks; block++) {
+				offsets[block * digitValues + value] = offset;
+				offset += counts[block * countsStride + countsOffset + value];
+			}
+		}
+		forEachBlock([&](std::size_t block) {
+			auto [begin, end] = blockRange(block);
+			std::size_t* blockOffsets = offsets.data() + block * digitValues;
+			for (std::size_t i = begin; i < end; i++) destination[blockOffsets[digit(source[i], position)]++] = source[i];
+		});
+		std::swap(source, destination);
+		counted = blocks == 1;
+	}
+
+	forEachBlock([&](std::size_t block) {
+		auto [begin, end] = blockRange(block);
+		for (std::size_t i = begin; i < end; i++) values[i] = fromKey(source[i]);
+	});
+}
+
+void RadixSorter::sort(std::span<FloatType> values) {
+	if (values.size() < radixSortThreshold) {
+		std::ranges::sort(values);
+		return;
+	}
+	sortBlocks(values, 1, [](auto&& body) { body(0); });
+}
+
+void RadixSorter::sort(std::span<FloatType> values, ThreadPool& pool) {
+	if (values.size() < radixSortThreshold) {
+		std::ranges::sort(values);
+		return;
+	}
+	// Blocks are large enough for the count and offset tables to stay small next to them.
+	std::size_t blocks = std::clamp<std::size_t>(values.size() / (digitValues * 32), 1, pool.size());
+	sortBlocks(values, blocks, [&](auto&& body) { pool.parallelFor(blocks, body); });
+}
+
+
+std::vector<std::pair<FloatType, FloatType>> runLengthEncode(std::span<const FloatType> sortedValues) {
+	std::vector<std::pair<FloatType, FloatType>> series;
+	for (FloatType value : sortedValues) {
+		if (!series.empty() && series.back().first == value) series.back().second++;
+		else series.emplace_back(value, 1);
+	}
+	return series;
+}
+
+}
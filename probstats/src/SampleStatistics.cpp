@@ -0,0 +1,33 @@
+﻿#include "probstats/SampleStatistics.h"
+
+
+namespace probstats {
+
+SampleStatistics sampleStatistics(const MomentAccumulator<FloatType, true>& moments) {
+	SampleStatistics statistics;
+	statistics.sampleSize = moments.count;
+	statistics.mean = moments.mean;
+	statistics.biasedVariance = moments.biasedVariance();
+	statistics.unbiasedVariance = statistics.biasedVariance * statistics.sampleSize / (statistics.sampleSize - 1);
+	statistics.biasedStandardDeviation = std::sqrt(statistics.biasedVariance);
+	statistics.unbiasedStandardDeviation = std::sqrt(statistics.unbiasedVariance);
+	statistics.skewness = std::sqrt(moments.count) * moments.m3 / std::pow(moments.m2, 1.5);
+	statistics.excessKurtosis = moments.count * moments.m4 / (moments.m2 * moments.m2) - 3;
+	return statistics;
+}
+
+SampleStatistics sampleStatistics(std::span<const FloatType> values, ThreadPool& pool) {
+	return sampleStatistics(parallelSampleMoments<FloatType, true>(pool, values));
+}
+
+SampleStatistics sampleStatistics(std::span<const std::pair<FloatType, FloatType>> series, ThreadPool& pool) {
+	return sampleStatistics(variationalSeriesMoments(series, pool));
+}
+
+
+MomentAccumulator<FloatType, true> variationalSeriesMoments(std::span<const std::pair<FloatType, FloatType>> series, ThreadPool& pool) {
+	if (auto exactMoments = exactIntegerMoments<FloatType, true>(series)) return *exactMoments;
+	return parallelSampleMoments<FloatType, true>(pool, series);
+}
+
+}
@@ -0,0 +1,311 @@
+﻿#include "probstats/Moments.h"
+
+#include <array>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_TARGET(features) __attribute__((target(features)))
+#else
+#define SIMD_TARGET(features)
+#endif
+
+
+namespace probstats {
+
+namespace {
+
+enum class SimdLevel { Scalar, Sse2, Avx2, Avx512 };
+
+SimdLevel detectSimdLevel() {
+#ifdef SIMD_X86
+	auto cpuid = [](unsigned leaf, unsigned subleaf) {
+		std::array<unsigned, 4> registers{};
+#ifdef _MSC_VER
+		__cpuidex(reinterpret_cast<int*>(registers.data()), leaf, subleaf);
+#else
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+		return registers;
+	};
+	auto osEnabledState = []() -> unsigned long long {
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned low, high;
+		__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return (static_cast<unsigned long long>(high) << 32) | low;
+#endif
+	};
+
+	auto leaf1 = cpuid(1, 0);
+	if (!(leaf1[3] & (1u << 26))) return SimdLevel::Scalar;
+	bool osSavesAvx = (leaf1[2] & (1u << 27)) && (osEnabledState() & 0x6) == 0x6;
+	if (!osSavesAvx || cpuid(0, 0)[0] < 7) return SimdLevel::Sse2;
+
+	auto leaf7 = cpuid(7, 0);
+	bool avx2 = (leaf1[2] & (1u << 28)) && (leaf1[2] & (1u << 12)) && (leaf7[1] & (1u << 5));
+	bool avx512 = avx2 && (leaf7[1] & (1u << 16)) && (osEnabledState() & 0xE6) == 0xE6;
+	return avx512 ? SimdLevel::Avx512 : avx2 ? SimdLevel::Avx2 : SimdLevel::Sse2;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+
+// The SIMD kernels accumulate sums of powers of (value - shift) in double precision over short
+// blocks, shifting by the first value of each block to avoid cancellation, and merge the per-block
+// moments. This keeps the inner loops free of divisions. The extremes are tracked in separate lanes
+// alongside the sums, and the third and fourth powers only when the higher moments are requested.
+constexpr std::size_t simdBlockSize = 2048;
+
+struct BlockSums {
+	double sum = 0, squares = 0, cubes = 0, fourths = 0;
+	double min, max;
+
+	void add(double value, double shift) {
+		double delta = value - shift, deltaSquared = delta * delta;
+		sum += delta;
+		squares += deltaSquared;
+		cubes += deltaSquared * delta;
+		fourths += deltaSquared * deltaSquared;
+		min = std::min(min, value);
+		max = std::max(max, value);
+	}
+};
+
+// Central moments of a block from the power sums about its shift.
+template<std::floating_point T, bool HigherMoments>
+MomentAccumulator<T, HigherMoments> shiftedBlockMoments(std::size_t count, double shift, const BlockSums& sums) {
+	double shiftedMean = sums.sum / count;
+	MomentAccumulator<T, HigherMoments> moments;
+	moments.count = static_cast<T>(count);
+	moments.mean = static_cast<T>(shift + shiftedMean);
+	moments.m2 = static_cast<T>(std::max(0.0, sums.squares - sums.sum * shiftedMean));
+	if constexpr (HigherMoments) {
+		double meanSquared = shiftedMean * shiftedMean;
+		moments.m3 = static_cast<T>(sums.cubes - 3 * shiftedMean * sums.squares + 2 * count * meanSquared * shiftedMean);
+		moments.m4 = static_cast<T>(std::max(0.0,
+			sums.fourths - 4 * shiftedMean * sums.cubes + 6 * meanSquared * sums.squares - 3 * count * meanSquared * meanSquared));
+	}
+	moments.min = static_cast<T>(sums.min);
+	moments.max = static_cast<T>(sums.max);
+	return moments;
+}
+
+template<std::floating_point T, bool HigherMoments>
+MomentAccumulator<T, HigherMoments> momentsKernelScalar(const T* values, std::size_t size) {
+	MomentAccumulator<T, HigherMoments> moments;
+	for (std::size_t blockBegin = 0; blockBegin < size; blockBegin += simdBlockSize) {
+		std::size_t blockEnd = std::min(size, blockBegin + simdBlockSize);
+		double shift = values[blockBegin];
+		BlockSums sums{ .min = shift, .max = shift };
+		for (std::size_t i = blockBegin; i < blockEnd; i++) sums.add(values[i], shift);
+		moments.merge(shiftedBlockMoments<T, HigherMoments>(blockEnd - blockBegin, shift, sums));
+	}
+	return moments;
+}
+
+#ifdef SIMD_X86
+template<std::floating_point T, bool HigherMoments>
+SIMD_TARGET("sse2") MomentAccumulator<T, HigherMoments> momentsKernelSse2(const T* values, std::size_t size) {
+	MomentAccumulator<T, HigherMoments> moments;
+	for (std::size_t blockBegin = 0; blockBegin < size; blockBegin += simdBlockSize) {
+		std::size_t blockEnd = std::min(size, blockBegin + simdBlockSize), i = blockBegin;
+		double shift = values[blockBegin];
+		__m128d shiftVector = _mm_set1_pd(shift);
+		__m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd(), squares0 = _mm_setzero_pd(), squares1 = _mm_setzero_pd();
+		__m128d cubes0 = _mm_setzero_pd(), cubes1 = _mm_setzero_pd(), fourths0 = _mm_setzero_pd(), fourths1 = _mm_setzero_pd();
+		__m128d min0 = shiftVector, min1 = shiftVector, max0 = shiftVector, max1 = shiftVector;
+		for (; i + 4 <= blockEnd; i += 4) {
+			__m128d value0, value1;
+			if constexpr (std::same_as<T, double>) {
+				value0 = _mm_loadu_pd(values + i);
+				value1 = _mm_loadu_pd(values + i + 2);
+			} else {
+				__m128 packed = _mm_loadu_ps(values + i);
+				value0 = _mm_cvtps_pd(packed);
+				value1 = _mm_cvtps_pd(_mm_movehl_ps(packed, packed));
+			}
+			__m128d delta0 = _mm_sub_pd(value0, shiftVector), delta1 = _mm_sub_pd(value1, shiftVector);
+			__m128d deltaSquared0 = _mm_mul_pd(delta0, delta0), deltaSquared1 = _mm_mul_pd(delta1, delta1);
+			sum0 = _mm_add_pd(sum0, delta0);
+			sum1 = _mm_add_pd(sum1, delta1);
+			squares0 = _mm_add_pd(squares0, deltaSquared0);
+			squares1 = _mm_add_pd(squares1, deltaSquared1);
+			if constexpr (HigherMoments) {
+				cubes0 = _mm_add_pd(cubes0, _mm_mul_pd(deltaSquared0, delta0));
+				cubes1 = _mm_add_pd(cubes1, _mm_mul_pd(deltaSquared1, delta1));
+				fourths0 = _mm_add_pd(fourths0, _mm_mul_pd(deltaSquared0, deltaSquared0));
+				fourths1 = _mm_add_pd(fourths1, _mm_mul_pd(deltaSquared1, deltaSquared1));
+			}
+			min0 = _mm_min_pd(min0, value0);
+			min1 = _mm_min_pd(min1, value1);
+			max0 = _mm_max_pd(max0, value0);
+			max1 = _mm_max_pd(max1, value1);
+		}
+		alignas(16) double lanes[6][2];
+		_mm_store_pd(lanes[0], _mm_add_pd(sum0, sum1));
+		_mm_store_pd(lanes[1], _mm_add_pd(squares0, squares1));
+		_mm_store_pd(lanes[2], _mm_add_pd(cubes0, cubes1));
+		_mm_store_pd(lanes[3], _mm_add_pd(fourths0, fourths1));
+		_mm_store_pd(lanes[4], _mm_min_pd(min0, min1));
+		_mm_store_pd(lanes[5], _mm_max_pd(max0, max1));
+		BlockSums sums{ lanes[0][0] + lanes[0][1], lanes[1][0] + lanes[1][1], lanes[2][0] + lanes[2][1], lanes[3][0] + lanes[3][1],
+			std::min(lanes[4][0], lanes[4][1]), std::max(lanes[5][0], lanes[5][1]) };
+		for (; i < blockEnd; i++) sums.add(values[i], shift);
+		moments.merge(shiftedBlockMoments<T, HigherMoments>(blockEnd - blockBegin, shift, sums));
+	}
+	return moments;
+}
+
+template<std::floating_point T, bool HigherMoments>
+SIMD_TARGET("avx2,fma") MomentAccumulator<T, HigherMoments> momentsKernelAvx2(const T* values, std::size_t size) {
+	MomentAccumulator<T, HigherMoments> moments;
+	for (std::size_t blockBegin = 0; blockBegin < size; blockBegin += simdBlockSize) {
+		std::size_t blockEnd = std::min(size, blockBegin + simdBlockSize), i = blockBegin;
+		double shift = values[blockBegin];
+		__m256d shiftVector = _mm256_set1_pd(shift);
+		__m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+		__m256d squares0 = _mm256_setzero_pd(), squares1 = _mm256_setzero_pd();
+		__m256d cubes0 = _mm256_setzero_pd(), cubes1 = _mm256_setzero_pd();
+		__m256d fourths0 = _mm256_setzero_pd(), fourths1 = _mm256_setzero_pd();
+		__m256d min0 = shiftVector, min1 = shiftVector, max0 = shiftVector, max1 = shiftVector;
+		for (; i + 8 <= blockEnd; i += 8) {
+			__m256d value0, value1;
+			if constexpr (std::same_as<T, double>) {
+				value0 = _mm256_loadu_pd(values + i);
+				value1 = _mm256_loadu_pd(values + i + 4);
+			} else {
+				value0 = _mm256_cvtps_pd(_mm_loadu_ps(values + i));
+				value1 = _mm256_cvtps_pd(_mm_loadu_ps(values + i + 4));
+			}
+			__m256d delta0 = _mm256_sub_pd(value0, shiftVector), delta1 = _mm256_sub_pd(value1, shiftVector);
+			sum0 = _mm256_add_pd(sum0, delta0);
+			sum1 = _mm256_add_pd(sum1, delta1);
+			if constexpr (HigherMoments) {
+				__m256d deltaSquared0 = _mm256_mul_pd(delta0, delta0), deltaSquared1 = _mm256_mul_pd(delta1, delta1);
+				squares0 = _mm256_add_pd(squares0, deltaSquared0);
+				squares1 = _mm256_add_pd(squares1, deltaSquared1);
+				cubes0 = _mm256_fmadd_pd(deltaSquared0, delta0, cubes0);
+				cubes1 = _mm256_fmadd_pd(deltaSquared1, delta1, cubes1);
+				fourths0 = _mm256_fmadd_pd(deltaSquared0, deltaSquared0, fourths0);
+				fourths1 = _mm256_fmadd_pd(deltaSquared1, deltaSquared1, fourths1);
+			} else {
+				squares0 = _mm256_fmadd_pd(delta0, delta0, squares0);
+				squares1 = _mm256_fmadd_pd(delta1, delta1, squares1);
+			}
+			min0 = _mm256_min_pd(min0, value0);
+			min1 = _mm256_min_pd(min1, value1);
+			max0 = _mm256_max_pd(max0, value0);
+			max1 = _mm256_max_pd(max1, value1);
+		}
+		alignas(32) double lanes[6][4];
+		_mm256_store_pd(lanes[0], _mm256_add_pd(sum0, sum1));
+		_mm256_store_pd(lanes[1], _mm256_add_pd(squares0, squares1));
+		_mm256_store_pd(lanes[2], _mm256_add_pd(cubes0, cubes1));
+		_mm256_store_pd(lanes[3], _mm256_add_pd(fourths0, fourths1));
+		_mm256_store_pd(lanes[4], _mm256_min_pd(min0, min1));
+		_mm256_store_pd(lanes[5], _mm256_max_pd(max0, max1));
+		auto laneSum = [](const double* lane) { return (lane[0] + lane[1]) + (lane[2] + lane[3]); };
+		BlockSums sums{ laneSum(lanes[0]), laneSum(lanes[1]), laneSum(lanes[2]), laneSum(lanes[3]),
+			std::min({ lanes[4][0], lanes[4][1], lanes[4][2], lanes[4][3] }), std::max({ lanes[5][0], lanes[5][1], lanes[5][2], lanes[5][3] }) };
+		for (; i < blockEnd; i++) sums.add(values[i], shift);
+		moments.merge(shiftedBlockMoments<T, HigherMoments>(blockEnd - blockBegin, shift, sums));
+	}
+	return moments;
+}
+
+template<std::floating_point T, bool HigherMoments>
+SIMD_TARGET("avx512f") MomentAccumulator<T, HigherMoments> momentsKernelAvx512(const T* values, std::size_t size) {
+	MomentAccumulator<T, HigherMoments> moments;
+	for (std::size_t blockBegin = 0; blockBegin < size; blockBegin += simdBlockSize) {
+		std::size_t blockEnd = std::min(size, blockBegin + simdBlockSize), i = blockBegin;
+		double shift = values[blockBegin];
+		__m512d shiftVector = _mm512_set1_pd(shift);
+		__m512d sum0 = _mm512_setzero_pd(), sum1 = _mm512_setzero_pd();
+		__m512d squares0 = _mm512_setzero_pd(), squares1 = _mm512_setzero_pd();
+		__m512d cubes0 = _mm512_setzero_pd(), cubes1 = _mm512_setzero_pd();
+		__m512d fourths0 = _mm512_setzero_pd(), fourths1 = _mm512_setzero_pd();
+		__m512d min0 = shiftVector, min1 = shiftVector, max0 = shiftVector, max1 = shiftVector;
+		for (; i + 16 <= blockEnd; i += 16) {
+			__m512d value0, value1;
+			if constexpr (std::same_as<T, double>) {
+				value0 = _mm512_loadu_pd(values + i);
+				value1 = _mm512_loadu_pd(values + i + 8);
+			} else {
+				value0 = _mm512_cvtps_pd(_mm256_loadu_ps(values + i));
+				value1 = _mm512_cvtps_pd(_mm256_loadu_ps(values + i + 8));
+			}
+			__m512d delta0 = _mm512_sub_pd(value0, shiftVector), delta1 = _mm512_sub_pd(value1, shiftVector);
+			sum0 = _mm512_add_pd(sum0, delta0);
+			sum1 = _mm512_add_pd(sum1, delta1);
+			if constexpr (HigherMoments) {
+				__m512d deltaSquared0 = _mm512_mul_pd(delta0, delta0), deltaSquared1 = _mm512_mul_pd(delta1, delta1);
+				squares0 = _mm512_add_pd(squares0, deltaSquared0);
+				squares1 = _mm512_add_pd(squares1, deltaSquared1);
+				cubes0 = _mm512_fmadd_pd(deltaSquared0, delta0, cubes0);
+				cubes1 = _mm512_fmadd_pd(deltaSquared1, delta1, cubes1);
+				fourths0 = _mm512_fmadd_pd(deltaSquared0, deltaSquared0, fourths0);
+				fourths1 = _mm512_fmadd_pd(deltaSquared1, deltaSquared1, fourths1);
+			} else {
+				squares0 = _mm512_fmadd_pd(delta0, delta0, squares0);
+				squares1 = _mm512_fmadd_pd(delta1, delta1, squares1);
+			}
+			min0 = _mm512_min_pd(min0, value0);
+			min1 = _mm512_min_pd(min1, value1);
+			max0 = _mm512_max_pd(max0, value0);
+			max1 = _mm512_max_pd(max1, value1);
+		}
+		BlockSums sums{
+			_mm512_reduce_add_pd(_mm512_add_pd(sum0, sum1)), _mm512_reduce_add_pd(_mm512_add_pd(squares0, squares1)),
+			_mm512_reduce_add_pd(_mm512_add_pd(cubes0, cubes1)), _mm512_reduce_add_pd(_mm512_add_pd(fourths0, fourths1)),
+			_mm512_reduce_min_pd(_mm512_min_pd(min0, min1)), _mm512_reduce_max_pd(_mm512_max_pd(max0, max1))
+		};
+		for (; i < blockEnd; i++) sums.add(values[i], shift);
+		moments.merge(shiftedBlockMoments<T, HigherMoments>(blockEnd - blockBegin, shift, sums));
+	}
+	return moments;
+}
+#endif
+
+
+template<SimdFloat T, bool HigherMoments>
+MomentAccumulator<T, HigherMoments> dispatchSampleMoments(const T* values, std::size_t size) {
+	using Kernel = MomentAccumulator<T, HigherMoments>(*)(const T*, std::size_t);
+	static const Kernel kernel = [] () -> Kernel {
+		switch (detectSimdLevel()) {
+#ifdef SIMD_X86
+		case SimdLevel::Avx512: return momentsKernelAvx512<T, HigherMoments>;
+		case SimdLevel::Avx2: return momentsKernelAvx2<T, HigherMoments>;
+		case SimdLevel::Sse2: return momentsKernelSse2<T, HigherMoments>;
+#endif
+		default: return momentsKernelScalar<T, HigherMoments>;
+		}
+	}();
+	return kernel(values, size);
+}
+
+}
+
+
+template<SimdFloat T, bool HigherMoments>
+MomentAccumulator<T, HigherMoments> contiguousSampleMoments(const T* values, std::size_t size) {
+	return dispatchSampleMoments<T, HigherMoments>(values, size);
+}
+
+template MomentAccumulator<float, false> contiguousSampleMoments<float, false>(const float* values, std::size_t size);
+template MomentAccumulator<float, true> contiguousSampleMoments<float, true>(const float* values, std::size_t size);
+template MomentAccumulator<double, false> contiguousSampleMoments<double, false>(const double* values, std::size_t size);
+template MomentAccumulator<double, true> contiguousSampleMoments<double, true>(const double* values, std::size_t size);
+
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <string_view>
+
+#include <probstats/MomentAccumulator.h>
+
+
+namespace probstats::test {
+
+// Failed checks are reported and counted, so that a test reports all of them and returns the count from main.
+inline int failures = 0;
+
+inline void check(bool condition, std::string_view description) {
+	if (condition) return;
+	failures++;
+	std::cerr << "Failed: " << description << '\n';
+}
+
+inline bool isClose(FloatType actual, FloatType expected, FloatType tolerance) {
+	return std::abs(actual - expected) <= tolerance * std::max<FloatType>(1, std::abs(expected));
+}
+
+}
@@ -0,0 +1,68 @@
+﻿#include <random>
+#include <format>
+#include <vector>
+
+#include <probstats/SampleStatistics.h>
+
+#include "Check.h"
+
+
+using namespace probstats;
+using namespace probstats::test;
+
+
+// Skewness and excess kurtosis from two passes in long double.
+std::pair<FloatType, FloatType> referenceShape(std::span<const FloatType> values) {
+	long double sum = 0;
+	for (FloatType value : values) sum += value;
+	long double mean = sum / values.size(), m2 = 0, m3 = 0, m4 = 0;
+	for (FloatType value : values) {
+		long double deviation = value - mean;
+		m2 += deviation * deviation;
+		m3 += deviation * deviation * deviation;
+		m4 += deviation * deviation * deviation * deviation;
+	}
+	long double n = values.size();
+	return { static_cast<FloatType>(std::sqrt(n) * m3 / std::pow(m2, 1.5L)), static_cast<FloatType>(n * m4 / (m2 * m2) - 3) };
+}
+
+void checkShape(const SampleStatistics& statistics, std::span<const FloatType> values, std::string_view name) {
+	auto [skewness, excessKurtosis] = referenceShape(values);
+	check(statistics.sampleSize == values.size(), std::format("{}: sample size", name));
+	check(isClose(statistics.skewness, skewness, 1e-10), std::format("{}: skewness {} instead of {}", name, statistics.skewness, skewness));
+	check(isClose(statistics.excessKurtosis, excessKurtosis, 1e-10),
+		std::format("{}: excess kurtosis {} instead of {}", name, statistics.excessKurtosis, excessKurtosis));
+}
+
+
+int main() {
+	ThreadPool pool(4);
+	std::mt19937_64 generator(1);
+
+	// Sizes that leave tails for the SIMD kernels and span several parallel chunks, on a shifted
+	// symmetric and a skewed distribution.
+	for (std::size_t size : { 7, 1001, 300001 }) {
+		std::normal_distribution<FloatType> normal(1e4, 3);
+		std::exponential_distribution<FloatType> exponential(0.5);
+		std::vector<FloatType> normalValues(size), exponentialValues(size);
+		for (auto& value : normalValues) value = normal(generator);
+		for (auto& value : exponentialValues) value = exponential(generator);
+		checkShape(sampleStatistics(normalValues, pool), normalValues, std::format("normal values of size {}", size));
+		checkShape(sampleStatistics(exponentialValues, pool), exponentialValues, std::format("exponential values of size {}", size));
+	}
+
+	// Series, with integer amounts summed exactly and fractional values through the weighted pass.
+	for (FloatType step : { 1.0, 0.25 }) {
+		std::poisson_distribution<int> amounts(20);
+		std::vector<std::pair<FloatType, FloatType>> series;
+		std::vector<FloatType> values;
+		for (int i = 0; i < 200; i++) {
+			FloatType value = -50 + i * step, amount = amounts(generator) * (i % 3 == 0 ? 3 : 1);
+			series.emplace_back(value, amount);
+			values.insert(values.end(), static_cast<std::size_t>(amount), value);
+		}
+		checkShape(sampleStatistics(series, pool), values, std::format("series with step {}", step));
+	}
+
+	return failures;
+}
@@ -0,0 +1,127 @@
+﻿#include <random>
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/math/distributions/binomial.hpp>
+
+#include <probstats/OrderStatistics.h>
+
+#include "Check.h"
+
+
+using namespace probstats;
+using namespace probstats::test;
+
+
+template<class F>
+bool throwsInvalidArgument(F&& f) {
+	try {
+		f();
+	} catch (const std::invalid_argument&) {
+		return true;
+	}
+	return false;
+}
+
+void checkOrderStatistics(std::span<const FloatType> values, std::span<const std::uint64_t> ranks, ThreadPool& pool, std::string_view name) {
+	auto statistics = orderStatistics(values, ranks, pool);
+	for (std::size_t i = 0; i < ranks.size(); i++) {
+		std::vector<FloatType> copy(values.begin(), values.end());
+		std::nth_element(copy.begin(), copy.begin() + ranks[i], copy.end());
+		check(statistics[i] == copy[ranks[i]], std::format("{}: rank {} is {} instead of {}", name, ranks[i], statistics[i], copy[ranks[i]]));
+	}
+}
+
+// The bounds of the median interval by its definition: l is the largest rank with P(l <= B <= n - l) >= confidence.
+ConfidenceInterval referenceMedianInterval(std::span<const FloatType> sortedValues, FloatType confidence) {
+	std::size_t n = sortedValues.size();
+	boost::math::binomial distribution(static_cast<FloatType>(n), 0.5);
+	std::size_t l = 0;
+	for (std::size_t candidate = 1; 2 * candidate <= n; candidate++) {
+		FloatType coverage = boost::math::cdf(distribution, static_cast<FloatType>(n - candidate))
+			- boost::math::cdf(distribution, static_cast<FloatType>(candidate - 1));
+		if (coverage >= confidence) l = candidate;
+	}
+	return { sortedValues[l - 1], sortedValues[n - l] };
+}
+
+
+int main() {
+	ThreadPool pool(4);
+	std::mt19937_64 generator(1);
+
+	std::normal_distribution<FloatType> normal(0, 1);
+	std::uniform_int_distribution<int> fewValues(0, 9);
+	for (std::size_t size : { 1, 2, 1000, 1000001 }) {
+		std::vector<FloatType> random(size), duplicates(size), ascending(size), descending(size), equal(size, 3);
+		for (auto& value : random) value = normal(generator);
+		for (auto& value : duplicates) value = fewValues(generator);
+		for (std::size_t i = 0; i < size; i++) ascending[i] = static_cast<FloatType>(i);
+		std::ranges::reverse_copy(ascending, descending.begin());
+
+		std::vector<std::uint64_t> ranks{ 0, size / 4, size / 2, size - 1 - size / 4, size - 1 };
+		checkOrderStatistics(random, ranks, pool, std::format("random values of size {}", size));
+		checkOrderStatistics(duplicates, ranks, pool, std::format("duplicated values of size {}", size));
+		checkOrderStatistics(ascending, ranks, pool, std::format("ascending values of size {}", size));
+		checkOrderStatistics(descending, ranks, pool, std::format("descending values of size {}", size));
+		checkOrderStatistics(equal, ranks, pool, std::format("equal values of size {}", size));
+		std::uint64_t pastEnd[] = { size };
+		check(throwsInvalidArgument([&] { orderStatistics(random, pastEnd, pool); }), std::format("size {}: rank past the end", size));
+	}
+
+	// Series agree with the values they stand for.
+	std::vector<std::pair<FloatType, FloatType>> series;
+	std::vector<FloatType> seriesValues;
+	std::poisson_distribution<int> amounts(30);
+	for (int i = 0; i < 100; i++) {
+		FloatType value = i * 0.5, amount = amounts(generator);
+		series.emplace_back(value, amount);
+		seriesValues.insert(seriesValues.end(), static_cast<std::size_t>(amount), value);
+	}
+	std::vector<std::uint64_t> seriesRanks{ 0, 17, seriesValues.size() / 2, seriesValues.size() - 1 };
+	auto fromSeries = orderStatistics(series, seriesRanks);
+	auto fromValues = orderStatistics(seriesValues, seriesRanks, pool);
+	check(fromSeries == fromValues, "series: order statistics differ from those of its values");
+	auto fractional = series;
+	fractional[3].second = 0.5;
+	check(!hasIntegerAmounts(fractional), "series: fractional amounts are counts");
+	check(throwsInvalidArgument([&] { orderStatistics(fractional, seriesRanks); }), "series: fractional amounts");
+
+	// Quantiles interpolate between the order statistics around rank (n - 1) p.
+	std::vector<FloatType> values(10001);
+	for (auto& value : values) value = normal(generator);
+	auto sortedValues = values;
+	std::ranges::sort(sortedValues);
+	std::vector<FloatType> probabilities{ 0, 0.01, 0.25, 0.5, 0.123456, 0.99, 1 };
+	auto quantiles = exactQuantiles(values, probabilities, pool);
+	for (std::size_t i = 0; i < probabilities.size(); i++) {
+		FloatType position = (values.size() - 1) * probabilities[i];
+		auto below = static_cast<std::size_t>(position);
+		auto above = std::min(below + 1, values.size() - 1);
+		FloatType expected = sortedValues[below] + (position - below) * (sortedValues[above] - sortedValues[below]);
+		check(isClose(quantiles[i], expected, 1e-15), std::format("quantile {} instead of {} at {}", quantiles[i], expected, probabilities[i]));
+	}
+	check(exactQuantiles(series, probabilities) == exactQuantiles(seriesValues, probabilities, pool), "series: quantiles differ from those of its values");
+
+	// Median intervals, from the smallest samples that reach the confidence: 6 values for 0.95.
+	for (std::size_t size : { 6, 7, 20, 101, 10000 }) {
+		std::span<const FloatType> sample(values.data(), size);
+		std::vector<FloatType> sortedSample(sample.begin(), sample.end());
+		std::ranges::sort(sortedSample);
+		for (FloatType confidence : { 0.9, 0.95 }) {
+			auto interval = medianConfidenceInterval(sample, confidence, pool);
+			auto expected = referenceMedianInterval(sortedSample, confidence);
+			check(interval.lower == expected.lower && interval.upper == expected.upper,
+				std::format("median interval of {} values at {}: ({}, {}) instead of ({}, {})", size, confidence,
+					interval.lower, interval.upper, expected.lower, expected.upper));
+		}
+	}
+	auto seriesInterval = medianConfidenceInterval(series, 0.95);
+	auto valuesInterval = medianConfidenceInterval(seriesValues, 0.95, pool);
+	check(seriesInterval.lower == valuesInterval.lower && seriesInterval.upper == valuesInterval.upper, "series: median interval");
+	check(throwsInvalidArgument([&] { medianConfidenceInterval(std::span(values).first(5), 0.95, pool); }), "median interval of 5 values at 0.95");
+
+	return failures;
+}
@@ -0,0 +1,100 @@
+﻿#include <random>
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <vector>
+
+#include <probstats/QuantileSketch.h>
+#include <probstats/OrderStatistics.h>
+
+#include "Check.h"
+
+
+using namespace probstats;
+using namespace probstats::test;
+
+
+const std::vector<FloatType> probabilities{ 0.001, 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99, 0.999 };
+
+// The sketch is judged by rank rather than value: the fraction of the values below its quantile
+// must be close to the probability, closer in the tails, where the centroids are small.
+void checkRanks(QuantileSketch& sketch, std::span<const FloatType> sortedValues, std::string_view name) {
+	check(sketch.totalWeight() == sortedValues.size(), std::format("{}: total weight", name));
+	check(sketch.quantile(0) == sortedValues.front() && sketch.quantile(1) == sortedValues.back(), std::format("{}: extremes", name));
+	for (FloatType probability : probabilities) {
+		FloatType quantile = sketch.quantile(probability);
+		FloatType below = std::ranges::lower_bound(sortedValues, quantile) - sortedValues.begin();
+		FloatType rankError = std::abs(below / sortedValues.size() - probability);
+		FloatType tolerance = 3e-4 + 2e-3 * probability * (1 - probability);
+		check(rankError <= tolerance, std::format("{}: rank error {} at {}", name, rankError, probability));
+	}
+}
+
+bool sameQuantiles(QuantileSketch& first, QuantileSketch& second) {
+	return std::ranges::all_of(probabilities, [&](FloatType probability) { return first.quantile(probability) == second.quantile(probability); });
+}
+
+
+int main() {
+	ThreadPool pool(4), singleThread(1);
+	std::mt19937_64 generator(1);
+
+	std::lognormal_distribution<FloatType> distribution(0, 1);
+	std::vector<FloatType> values(1000000);
+	for (auto& value : values) value = distribution(generator);
+	auto sortedValues = values;
+	std::ranges::sort(sortedValues);
+
+	QuantileSketch oneByOne;
+	for (std::size_t i = 0; i < 100000; i++) oneByOne.add(values[i]);
+	std::vector<FloatType> sortedPrefix(values.begin(), values.begin() + 100000);
+	std::ranges::sort(sortedPrefix);
+	checkRanks(oneByOne, sortedPrefix, "values added one by one");
+
+	QuantileSketch batches;
+	for (std::size_t first = 0; first < values.size(); first += 50000) batches.add(std::span(values).subspan(first, 50000));
+	checkRanks(batches, sortedValues, "values added in batches");
+
+	auto sorted = valuesSketch(values);
+	checkRanks(sorted, sortedValues, "sketch of radix sorted values");
+
+	auto parallel = parallelQuantileSketch(pool, values);
+	checkRanks(parallel, sortedValues, "parallel sketch");
+	auto serial = parallelQuantileSketch(singleThread, values);
+	check(sameQuantiles(parallel, serial), "parallel sketch depends on the number of threads");
+
+	auto summary = parallelSampleSummary(pool, values);
+	checkRanks(summary.quantiles, sortedValues, "sample summary");
+	check(summary.moments.count == values.size(), "sample summary: moments count");
+
+	auto firstHalf = valuesSketch(std::span(values).first(values.size() / 2));
+	auto secondHalf = valuesSketch(std::span(values).subspan(values.size() / 2));
+	firstHalf.merge(secondHalf);
+	checkRanks(firstHalf, sortedValues, "merged halves");
+
+	// Buckets of a series take the whole range of ranks they cover, so its quantiles are within
+	// a bucket of the exact ones.
+	std::vector<std::pair<FloatType, FloatType>> series;
+	std::poisson_distribution<int> amounts(1000);
+	for (int value = 0; value < 50; value++) series.emplace_back(value, amounts(generator));
+	auto seriesSketch = variationalSeriesSketch(series);
+	FloatType seriesSize = 0;
+	for (const auto& [value, amount] : series) seriesSize += amount;
+	check(seriesSketch.totalWeight() == seriesSize, "variational series: total weight");
+	check(seriesSketch.quantile(0) == 0 && seriesSketch.quantile(1) == 49, "variational series: extremes");
+	auto exact = exactQuantiles(series, probabilities);
+	for (std::size_t i = 0; i < probabilities.size(); i++) {
+		FloatType quantile = seriesSketch.quantile(probabilities[i]);
+		check(std::abs(quantile - exact[i]) <= 1, std::format("variational series: quantile {} instead of {} at {}", quantile, exact[i], probabilities[i]));
+	}
+
+	bool emptyThrows = false;
+	try {
+		QuantileSketch().quantile(0.5);
+	} catch (const std::logic_error&) {
+		emptyThrows = true;
+	}
+	check(emptyThrows, "empty sketch: quantile does not throw");
+
+	return failures;
+}
@@ -0,0 +1,69 @@
+﻿#include <random>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <vector>
+
+#include <probstats/RadixSort.h>
+
+#include "Check.h"
+
+
+using namespace probstats;
+using namespace probstats::test;
+
+
+// Results are compared bit for bit, so that keys converted back to the wrong values are caught, except
+// for the sign of zero: the radix sort orders negative zero first, but short samples are sorted by comparison.
+void checkSort(std::vector<FloatType> values, RadixSorter& sorter, ThreadPool* pool, std::string_view name) {
+	auto expected = values;
+	std::ranges::sort(expected);
+	if (pool) sorter.sort(values, *pool);
+	else sorter.sort(values);
+	bool same = std::ranges::equal(values, expected, [](FloatType a, FloatType b) {
+		return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b) || (a == 0 && b == 0);
+	});
+	check(std::ranges::count(values, 0.0) == std::ranges::count(expected, 0.0)
+		&& std::ranges::count_if(values, [](FloatType value) { return value == 0 && std::signbit(value); })
+			== std::ranges::count_if(expected, [](FloatType value) { return value == 0 && std::signbit(value); }),
+		std::format("{}: zeros", name));
+	check(same, std::format("{} {}", name, pool ? "on a pool" : "on one thread"));
+}
+
+
+int main() {
+	ThreadPool pool(4);
+	RadixSorter sorter;
+	std::mt19937_64 generator(1);
+
+	// Sizes on both sides of the comparison sort threshold and of the block count growing with the pool.
+	for (std::size_t size : { 10, 4095, 4096, 100000, 3000000 }) {
+		// Random bit patterns cover every exponent, including denormals of both signs, whose keys are NaN
+		// bit patterns; NaNs among the values are replaced, since they have no order.
+		std::vector<FloatType> bits(size), special(size), shared(size), equal(size, -1.5);
+		for (auto& value : bits) {
+			do value = std::bit_cast<FloatType>(generator()); while (std::isnan(value));
+		}
+		constexpr FloatType infinity = std::numeric_limits<FloatType>::infinity();
+		const FloatType specialValues[] = { 0.0, -0.0, infinity, -infinity, std::numeric_limits<FloatType>::denorm_min(),
+			-std::numeric_limits<FloatType>::denorm_min(), std::numeric_limits<FloatType>::max(), -std::numeric_limits<FloatType>::max(), 1, -1 };
+		for (std::size_t i = 0; i < size; i++) special[i] = specialValues[generator() % std::size(specialValues)];
+		// Values whose keys share most digits, so that passes are skipped.
+		for (auto& value : shared) value = 1 + static_cast<FloatType>(generator() % 1000) / 1024;
+
+		for (auto* usePool : { static_cast<ThreadPool*>(nullptr), &pool }) {
+			checkSort(bits, sorter, usePool, std::format("random bit patterns of size {}", size));
+			checkSort(special, sorter, usePool, std::format("special values of size {}", size));
+			checkSort(shared, sorter, usePool, std::format("values sharing digits of size {}", size));
+			checkSort(equal, sorter, usePool, std::format("equal values of size {}", size));
+		}
+	}
+
+	std::vector<FloatType> sorted{ -1, -1, 0, 2, 2, 2, 5 };
+	auto series = runLengthEncode(sorted);
+	check(series == std::vector<std::pair<FloatType, FloatType>>{ { -1, 2 }, { 0, 1 }, { 2, 3 }, { 5, 1 } }, "run length encoding");
+
+	return failures;
+}